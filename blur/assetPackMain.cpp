@@ -0,0 +1,114 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "assetPackage.h"
+#include "ddsFormat.h"
+
+// Packs loose asset files into a single archive loaded by VkApp:
+//   assetpack assets.pak shaders/*.o textures/stonewall.dds
+
+namespace
+{
+bool hasExtension(const std::string& fileName, const char *extension)
+{
+    const size_t length = strlen(extension);
+    return fileName.size() > length && !fileName.compare(fileName.size() - length, length, extension);
+}
+
+// Finds texel data after DDS header and lays out mip levels as magma::Image expects them
+void describeTexture(const MappedFile& file, AssetEntry& asset, const void *& data, uint64_t& size)
+{
+    gliml::context ctx;
+    ctx.enable_dxt(true);
+    if (!ctx.load(file.getData(), static_cast<unsigned>(file.getSize())))
+        throw std::runtime_error("failed to load DDS texture");
+    if (ctx.num_mipmaps(0) > static_cast<int>(maxAssetMipLevels))
+        throw std::runtime_error("too many mip levels");
+    asset.type = AssetType::Texture;
+    asset.format = bcFormat(ctx);
+    asset.width = static_cast<uint32_t>(ctx.image_width(0, 0));
+    asset.height = static_cast<uint32_t>(ctx.image_height(0, 0));
+    asset.mipLevels = static_cast<uint32_t>(ctx.num_mipmaps(0));
+    const uint8_t *base = static_cast<const uint8_t *>(ctx.image_data(0, 0));
+    for (int level = 1; level < ctx.num_mipmaps(0); ++level)
+    {
+        asset.mipOffsets[level] = static_cast<const uint8_t *>(ctx.image_data(0, level)) -
+            static_cast<const uint8_t *>(ctx.image_data(0, level - 1));
+    }
+    const int lastLevel = ctx.num_mipmaps(0) - 1;
+    const uint8_t *end = static_cast<const uint8_t *>(ctx.image_data(0, lastLevel)) + ctx.image_size(0, lastLevel);
+    data = base;
+    size = end - base;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " output.pak file..." << std::endl;
+        return 1;
+    }
+    try
+    {
+        std::vector<std::unique_ptr<MappedFile>> files;
+        std::vector<AssetEntry> assets;
+        std::vector<const void *> contents;
+        const uint32_t assetCount = static_cast<uint32_t>(argc - 2);
+        uint64_t offset = sizeof(AssetPackageHeader) + assetCount * sizeof(AssetEntry);
+        for (int i = 2; i < argc; ++i)
+        {
+            const std::string name(argv[i]);
+            if (name.size() >= maxAssetNameLength)
+                throw std::runtime_error("name \"" + name + "\" is too long");
+            files.push_back(std::make_unique<MappedFile>(argv[i]));
+            const MappedFile& file = *files.back();
+            AssetEntry asset = {};
+            strcpy(asset.name, name.c_str());
+            const void *data = file.getData();
+            uint64_t size = file.getSize();
+            if (hasExtension(name, ".dds"))
+                describeTexture(file, asset, data, size);
+            else if (hasExtension(name, ".o"))
+            {
+                if (size < sizeof(uint32_t) || size % sizeof(uint32_t) ||
+                    *static_cast<const uint32_t *>(data) != 0x07230203)
+                    throw std::runtime_error("\"" + name + "\" is not a SPIR-V module");
+                asset.type = AssetType::Shader;
+            }
+            else
+                asset.type = AssetType::Raw;
+            offset = (offset + assetAlignment - 1) & ~uint64_t(assetAlignment - 1);
+            asset.offset = offset;
+            asset.size = size;
+            offset += size;
+            assets.push_back(asset);
+            contents.push_back(data);
+        }
+
+        std::ofstream package(argv[1], std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!package.is_open())
+            throw std::runtime_error("failed to create \"" + std::string(argv[1]) + "\"");
+        const AssetPackageHeader header = {assetPackageMagic, assetPackageVersion, assetCount, 0};
+        package.write(reinterpret_cast<const char *>(&header), sizeof(AssetPackageHeader));
+        package.write(reinterpret_cast<const char *>(assets.data()), assets.size() * sizeof(AssetEntry));
+        for (size_t i = 0; i < assets.size(); ++i)
+        {
+            const std::streamoff padding = assets[i].offset - package.tellp();
+            for (std::streamoff j = 0; j < padding; ++j)
+                package.put(0);
+            package.write(static_cast<const char *>(contents[i]), assets[i].size);
+            std::cout << assets[i].name << ": " << assets[i].size << " bytes" << std::endl;
+        }
+        if (!package)
+            throw std::runtime_error("failed to write \"" + std::string(argv[1]) + "\"");
+    }
+    catch (const std::exception& exc)
+    {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
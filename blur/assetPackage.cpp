@@ -0,0 +1,40 @@
+#include <cstring>
+#include <stdexcept>
+#include "assetPackage.h"
+
+AssetPackage::AssetPackage(const char *fileName):
+    file(std::make_unique<MappedFile>(fileName))
+{
+    const uint8_t *data = static_cast<const uint8_t *>(file->getData());
+    const uint64_t size = file->getSize();
+    const AssetPackageHeader *header = reinterpret_cast<const AssetPackageHeader *>(data);
+    if (size < sizeof(AssetPackageHeader) ||
+        header->magic != assetPackageMagic ||
+        header->version != assetPackageVersion)
+        throw std::runtime_error("\"" + std::string(fileName) + "\" is not an asset package");
+    if (sizeof(AssetPackageHeader) + uint64_t(header->assetCount) * sizeof(AssetEntry) > size)
+        throw std::runtime_error("asset package \"" + std::string(fileName) + "\" is truncated");
+    const AssetEntry *entries = reinterpret_cast<const AssetEntry *>(header + 1);
+    for (uint32_t i = 0; i < header->assetCount; ++i)
+    {
+        const AssetEntry& asset = entries[i];
+        if (asset.offset > size || asset.size > size - asset.offset ||
+            asset.mipLevels > maxAssetMipLevels ||
+            !memchr(asset.name, '\0', maxAssetNameLength))
+            throw std::runtime_error("asset package \"" + std::string(fileName) + "\" is corrupted");
+        assets[asset.name] = &asset;
+    }
+}
+
+const AssetEntry *AssetPackage::find(const char *name) const
+{
+    auto it = assets.find(name);
+    if (it != assets.end())
+        return it->second;
+    return nullptr;
+}
+
+const void *AssetPackage::getData(const AssetEntry& asset) const
+{
+    return static_cast<const uint8_t *>(file->getData()) + asset.offset;
+}
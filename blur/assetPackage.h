@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "mappedFile.h"
+
+// Single file with shaders and textures, written by assetpack tool.
+// Data of each asset is aligned, so it can be copied to staging
+// buffers straight from the mapped pages.
+
+constexpr uint32_t assetPackageMagic = 0x4b415052; // "RPAK"
+constexpr uint32_t assetPackageVersion = 1;
+constexpr uint32_t assetAlignment = 64;
+constexpr uint32_t maxAssetNameLength = 64;
+constexpr uint32_t maxAssetMipLevels = 16;
+
+enum class AssetType : uint32_t
+{
+    Raw,
+    Shader, // SPIR-V
+    Texture // Block-compressed mip chain without DDS header
+};
+
+struct AssetPackageHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t assetCount; // Followed by array of AssetEntry
+    uint32_t reserved;
+};
+
+struct AssetEntry
+{
+    char name[maxAssetNameLength]; // Relative path of the source file
+    AssetType type;
+    uint32_t format; // VkFormat of texture
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t reserved;
+    uint64_t offset; // From the beginning of package
+    uint64_t size;
+    uint64_t mipOffsets[maxAssetMipLevels]; // Relative to previous level, as in magma::Image::MipmapLayout
+};
+
+class AssetPackage
+{
+public:
+    explicit AssetPackage(const char *fileName);
+    // Returns nullptr if there is no such asset
+    const AssetEntry *find(const char *name) const;
+    const void *getData(const AssetEntry& asset) const;
+
+private:
+    std::unique_ptr<MappedFile> file;
+    std::unordered_map<std::string, const AssetEntry *> assets;
+};
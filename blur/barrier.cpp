@@ -0,0 +1,95 @@
+#include "barrier.h"
+
+VkImageMemoryBarrier imageLayoutBarrier(std::shared_ptr<magma::Image> image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+{
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = *image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    return barrier;
+}
+
+void imageLayoutTransition(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+    VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+{
+    const VkImageMemoryBarrier barrier = imageLayoutBarrier(image, oldLayout, newLayout,
+        srcAccessMask, dstAccessMask);
+    vkCmdPipelineBarrier(*cmdBuffer, srcStageMask, dstStageMask, 0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+}
+
+void blitImage(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> srcImage, const VkRect2D& srcRect,
+    std::shared_ptr<magma::Image> dstImage, const VkRect2D& dstRect)
+{
+    VkImageBlit region;
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.mipLevel = 0;
+    region.srcSubresource.baseArrayLayer = 0;
+    region.srcSubresource.layerCount = 1;
+    region.srcOffsets[0] = {srcRect.offset.x, srcRect.offset.y, 0};
+    region.srcOffsets[1] = {srcRect.offset.x + static_cast<int32_t>(srcRect.extent.width),
+        srcRect.offset.y + static_cast<int32_t>(srcRect.extent.height), 1};
+    region.dstSubresource = region.srcSubresource;
+    region.dstOffsets[0] = {dstRect.offset.x, dstRect.offset.y, 0};
+    region.dstOffsets[1] = {dstRect.offset.x + static_cast<int32_t>(dstRect.extent.width),
+        dstRect.offset.y + static_cast<int32_t>(dstRect.extent.height), 1};
+    vkCmdBlitImage(*cmdBuffer,
+        *srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        *dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &region, VK_FILTER_NEAREST);
+}
+
+void copyImageToBuffer(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> image, const VkExtent2D& extent,
+    std::shared_ptr<magma::Buffer> buffer)
+{
+    VkBufferImageCopy region;
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(*cmdBuffer, *image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *buffer, 1, &region);
+}
+
+void hostReadBarrier(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Buffer> buffer)
+{
+    VkBufferMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = *buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(*cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "../magma/magma.h"
+
+// Fills layout transition of the whole color image, so that
+// several of them can be merged into single pipeline barrier
+VkImageMemoryBarrier imageLayoutBarrier(std::shared_ptr<magma::Image> image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+
+// Records layout transition of the whole color image
+void imageLayoutTransition(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+    VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+
+// Records copy of rectangle between color images in transfer layouts,
+// converts format if needed
+void blitImage(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> srcImage, const VkRect2D& srcRect,
+    std::shared_ptr<magma::Image> dstImage, const VkRect2D& dstRect);
+
+// Records copy of the whole color image in transfer source layout to buffer,
+// rows are tightly packed
+void copyImageToBuffer(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Image> image, const VkExtent2D& extent,
+    std::shared_ptr<magma::Buffer> buffer);
+
+// Records dependency that makes transfer writes to buffer visible to host
+// once fence of submission is signaled
+void hostReadBarrier(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::Buffer> buffer);
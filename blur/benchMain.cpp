@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "blurApp.h"
+
+// Renders fixed number of frames with fixed animation step for each combination
+// of parameters and prints frame time statistics as JSON to standard output:
+//   bench --resolution 512x512,1920x1080 --mode naive,separable,compute,pyramid --kernel 7,15 --subdivision 16 --instances 1,100,10000 --present headless --frames 500
+
+namespace
+{
+struct Run
+{
+    uint32_t width;
+    uint32_t height;
+    std::string mode;
+    uint32_t kernelSize;
+    uint32_t pyramidLevels;
+    uint32_t subdivisionDegree;
+    uint32_t instanceCount;
+    std::string presentMode;
+};
+
+struct Percentiles
+{
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+};
+
+std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        items.push_back(item);
+    return items;
+}
+
+std::vector<uint32_t> splitNumbers(const std::string& list)
+{
+    std::vector<uint32_t> numbers;
+    for (const auto& item : split(list))
+        numbers.push_back(static_cast<uint32_t>(atoi(item.c_str())));
+    return numbers;
+}
+
+// Rectangles in X geometry format: WxH+X+Y,...
+bool parseRegions(const std::string& list, std::vector<VkRect2D>& regions)
+{
+    for (const auto& item : split(list))
+    {
+        VkRect2D region;
+        if (sscanf(item.c_str(), "%ux%u+%d+%d", &region.extent.width, &region.extent.height,
+            &region.offset.x, &region.offset.y) != 4)
+            return false;
+        regions.push_back(region);
+    }
+    return true;
+}
+
+bool parsePresentMode(const std::string& name, AppEntry& entry)
+{
+    static const std::map<std::string, VkPresentModeKHR> modes = {
+        {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+        {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+        {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+        {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR}
+    };
+    if ("headless" == name)
+    {
+        entry.headless = true;
+        return true;
+    }
+    auto it = modes.find(name);
+    if (it == modes.end())
+        return false;
+    entry.presentMode = it->second;
+    entry.vSync = (VK_PRESENT_MODE_FIFO_KHR == it->second);
+    return true;
+}
+
+bool parseBlurMode(const std::string& name, BlurSettings& settings)
+{
+    static const std::map<std::string, BlurMode> modes = {
+        {"naive", BlurMode::Naive},
+        {"separable", BlurMode::Separable},
+        {"compute", BlurMode::Compute},
+        {"pyramid", BlurMode::Pyramid}
+    };
+    auto it = modes.find(name);
+    if (it == modes.end())
+        return false;
+    settings.mode = it->second;
+    return true;
+}
+
+Percentiles computePercentiles(std::vector<double> values)
+{
+    Percentiles result = {0., 0., 0., 0.};
+    if (values.empty())
+        return result;
+    std::sort(values.begin(), values.end());
+    double sum = 0.;
+    for (double value : values)
+        sum += value;
+    auto nearestRank = [&values](double percentile) -> double
+    {
+        const size_t rank = static_cast<size_t>(percentile * 0.01 * (values.size() - 1) + 0.5);
+        return values[rank];
+    };
+    result.mean = sum / values.size();
+    result.p50 = nearestRank(50.);
+    result.p95 = nearestRank(95.);
+    result.p99 = nearestRank(99.);
+    return result;
+}
+
+void writePercentiles(std::ostream& os, const Percentiles& p)
+{
+    os << "\"mean\":" << p.mean << ",\"p50\":" << p.p50 << ",\"p95\":" << p.p95 << ",\"p99\":" << p.p99;
+}
+
+bool benchmark(const Run& run, uint32_t frameCount, uint32_t warmupCount, float frameTime, bool paused, bool bindless,
+    const std::vector<VkRect2D>& regions, const char *pipelineCacheFileName, const std::string& capturePrefix,
+    const std::string& recordFileName, bool recordBlocking, std::ostream& os)
+{
+    AppEntry entry;
+    entry.pipelineCacheFileName = pipelineCacheFileName;
+    entry.width = run.width;
+    entry.height = run.height;
+    if (!parsePresentMode(run.presentMode, entry))
+    {
+        std::cerr << "unknown present mode \"" << run.presentMode << "\"" << std::endl;
+        return false;
+    }
+    BlurSettings settings;
+    if (!parseBlurMode(run.mode, settings))
+    {
+        std::cerr << "unknown blur mode \"" << run.mode << "\"" << std::endl;
+        return false;
+    }
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+    if (!entry.headless)
+        createXcbWindow(entry, "Benchmark");
+#else
+    if (!entry.headless)
+    {
+        std::cerr << "only headless mode is supported in this build" << std::endl;
+        return false;
+    }
+#endif
+    settings.kernelSize = run.kernelSize;
+    settings.pyramidLevels = run.pyramidLevels;
+    settings.subdivisionDegree = run.subdivisionDegree;
+    settings.instanceCount = run.instanceCount;
+    settings.frameTime = frameTime;
+    settings.regions = regions;
+    settings.paused = paused;
+    settings.bindless = bindless;
+    std::unique_ptr<VkApp> app = createBlurApp(entry, settings);
+    if (!capturePrefix.empty())
+        app->captureAllFrames(capturePrefix);
+    if (!recordFileName.empty())
+        app->recordFrames(recordFileName, recordBlocking);
+
+    std::vector<double> frameTimes;
+    std::map<std::string, std::vector<double>> passTimes;
+    std::map<std::string, uint64_t> passFragments;
+    std::map<std::string, uint64_t> passSkips;
+    uint64_t lastFrame = 0;
+    bool hasFrame = false;
+    uint64_t heapAllocations = 0;
+    for (uint32_t i = 0; i < warmupCount + frameCount; ++i)
+    {
+        const uint64_t heapCount = getHeapAllocationCount();
+        const auto begin = std::chrono::high_resolution_clock::now();
+        app->render();
+        const auto end = std::chrono::high_resolution_clock::now();
+        if (i < warmupCount)
+            continue;
+        // Only allocations made by rendering, not by statistics below
+        heapAllocations += getHeapAllocationCount() - heapCount;
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        // GPU results of each frame are collected when its slot is reused
+        const Profiler::Frame *frame = app->getProfiler()->getLastFrame();
+        if (frame && frame->index >= warmupCount && (!hasFrame || frame->index != lastFrame))
+        {
+            for (const auto& section : frame->sections)
+            {
+                if (section.skipped)
+                    ++passSkips[section.name];
+                if (!section.available)
+                    continue;
+                passTimes[section.name].push_back(section.duration * 0.001);
+                passFragments[section.name] += section.fragmentInvocations;
+            }
+            lastFrame = frame->index;
+            hasFrame = true;
+        }
+    }
+    const double startupTime = app->getStartupTime();
+    const bool pipelineCacheWarm = app->isPipelineCacheWarm();
+    VkDeviceSize deviceMemory = 0;
+    for (VkDeviceSize heapUsage : app->getMemoryTracker()->getHeapUsage())
+        deviceMemory += heapUsage;
+    uint64_t skippedOffscreenPasses, skippedBlurPasses;
+    getSkippedPasses(app.get(), skippedOffscreenPasses, skippedBlurPasses);
+    const FrameCapture::Statistics capture = app->finishCaptures();
+    const FrameStream::Statistics record = app->finishRecording();
+    app.reset();
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+    if (!entry.headless)
+        destroyXcbWindow(entry);
+#endif
+
+    os << "{\"width\":" << run.width << ",\"height\":" << run.height
+        << ",\"mode\":\"" << run.mode << "\""
+        << ",\"kernelSize\":" << run.kernelSize
+        << ",\"pyramidLevels\":" << run.pyramidLevels
+        << ",\"subdivisionDegree\":" << run.subdivisionDegree
+        << ",\"instances\":" << run.instanceCount
+        << ",\"presentMode\":\"" << run.presentMode << "\""
+        << ",\"paused\":" << (paused ? "true" : "false")
+        << ",\"bindless\":" << (bindless ? "true" : "false")
+        << ",\"frames\":" << frameCount
+        << ",\"startupMs\":" << startupTime
+        << ",\"pipelineCache\":\"" << (pipelineCacheWarm ? "warm" : "cold") << "\""
+        << ",\"skippedOffscreenPasses\":" << skippedOffscreenPasses
+        << ",\"skippedBlurPasses\":" << skippedBlurPasses
+        << ",\"heapAllocations\":" << heapAllocations
+        << ",\"trackedMemoryBytes\":" << deviceMemory;
+    if (!capturePrefix.empty())
+    {   // Overhead per captured frame, including warmup
+        const double count = static_cast<double>(std::max<uint64_t>(capture.capturedCount + capture.failedCount, 1));
+        os << ",\"capturedFrames\":" << capture.capturedCount
+            << ",\"droppedCaptures\":" << capture.droppedCount
+            << ",\"captureRecordMs\":" << capture.recordMs/count
+            << ",\"captureEncodeMs\":" << capture.encodeMs/count;
+    }
+    if (!recordFileName.empty())
+    {
+        os << ",\"recordedFrames\":" << record.writtenFrames
+            << ",\"droppedRecordFrames\":" << record.droppedFrames + capture.droppedCount
+            << ",\"recordStallMs\":" << record.stallMs + capture.stallMs
+            << ",\"recordWriteMBps\":" << (record.writeMs > 0. ? record.bytesWritten/(record.writeMs * 1000.) : 0.);
+    }
+    os << ",\"frameTimeMs\":{";
+    writePercentiles(os, computePercentiles(frameTimes));
+    os << "},\"passes\":[";
+    bool first = true;
+    for (const auto& pass : passTimes)
+    {
+        const Percentiles p = computePercentiles(pass.second);
+        double totalTime = 0.;
+        for (double time : pass.second)
+            totalTime += time;
+        // Throughput in shaded fragments per second, if pipeline statistics are supported
+        const double fragmentsPerSecond = totalTime > 0. ? passFragments[pass.first] / (totalTime * 0.001) : 0.;
+        os << (first ? "" : ",") << "{\"name\":\"" << pass.first << "\",\"gpuTimeMs\":{";
+        writePercentiles(os, p);
+        os << "},\"fragmentsPerSecond\":" << fragmentsPerSecond
+            << ",\"skipped\":" << passSkips[pass.first] << "}";
+        first = false;
+    }
+    os << "]}";
+    return true;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> resolutions = {"512x512"};
+    std::vector<std::string> modes = {"separable"};
+    std::vector<uint32_t> kernelSizes = {7};
+    std::vector<uint32_t> pyramidLevels = {4};
+    std::vector<uint32_t> subdivisionDegrees = {16};
+    std::vector<uint32_t> instanceCounts = {1};
+    std::vector<std::string> presentModes = {"headless"};
+    uint32_t frameCount = 500;
+    uint32_t warmupCount = 20;
+    float frameTime = 1000.f/60.f;
+    std::vector<VkRect2D> regions;
+    bool paused = false;
+    bool bindless = false;
+    std::string capturePrefix;
+    std::string recordFileName;
+    bool recordBlocking = false;
+    const char *pipelineCacheFileName = AppEntry().pipelineCacheFileName;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if ("--resolution" == arg && hasValue)
+            resolutions = split(argv[++i]);
+        else if ("--mode" == arg && hasValue)
+            modes = split(argv[++i]);
+        else if ("--kernel" == arg && hasValue)
+            kernelSizes = splitNumbers(argv[++i]);
+        else if ("--levels" == arg && hasValue)
+            pyramidLevels = splitNumbers(argv[++i]);
+        else if ("--subdivision" == arg && hasValue)
+            subdivisionDegrees = splitNumbers(argv[++i]);
+        else if ("--instances" == arg && hasValue)
+            instanceCounts = splitNumbers(argv[++i]);
+        else if ("--present" == arg && hasValue)
+            presentModes = split(argv[++i]);
+        else if ("--regions" == arg && hasValue && parseRegions(argv[i + 1], regions))
+            ++i;
+        else if ("--no-pipeline-cache" == arg)
+            pipelineCacheFileName = nullptr;
+        else if ("--paused" == arg)
+            paused = true;
+        else if ("--bindless" == arg)
+            bindless = true;
+        else if ("--capture" == arg && hasValue)
+            capturePrefix = argv[++i];
+        else if ("--record" == arg && hasValue)
+            recordFileName = argv[++i];
+        else if ("--record-blocking" == arg)
+            recordBlocking = true;
+        else if ("--frames" == arg && hasValue)
+            frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--warmup" == arg && hasValue)
+            warmupCount = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--frame-time" == arg && hasValue)
+            frameTime = static_cast<float>(atof(argv[++i]));
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--resolution WxH,...] [--mode naive|separable|compute|pyramid,...]" << std::endl
+                << "    [--kernel M,...] [--levels N,...] [--subdivision N,...] [--instances N,...]" << std::endl
+                << "    [--present headless|immediate|mailbox|fifo|fifo_relaxed,...]" << std::endl
+                << "    [--regions WxH+X+Y,...] [--paused] [--bindless] [--capture prefix] [--record file] [--record-blocking] [--no-pipeline-cache] [--frames N] [--warmup N] [--frame-time ms]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Run> runs;
+    for (const auto& resolution : resolutions)
+    {
+        Run run;
+        if (sscanf(resolution.c_str(), "%ux%u", &run.width, &run.height) != 2)
+        {
+            std::cerr << "invalid resolution \"" << resolution << "\"" << std::endl;
+            return 1;
+        }
+        for (const auto& mode : modes)
+        for (uint32_t kernelSize : kernelSizes)
+        for (uint32_t levels : pyramidLevels)
+        for (uint32_t subdivisionDegree : subdivisionDegrees)
+        for (uint32_t instanceCount : instanceCounts)
+        for (const auto& presentMode : presentModes)
+        {
+            run.mode = mode;
+            run.kernelSize = kernelSize;
+            run.pyramidLevels = levels;
+            run.subdivisionDegree = subdivisionDegree;
+            run.instanceCount = instanceCount;
+            run.presentMode = presentMode;
+            runs.push_back(run);
+        }
+    }
+
+    std::cout << "{\"runs\":[" << std::endl;
+    bool first = true;
+    for (const auto& run : runs)
+    {
+        if (!first)
+            std::cout << "," << std::endl;
+        try
+        {
+            if (!benchmark(run, frameCount, warmupCount, frameTime, paused, bindless, regions, pipelineCacheFileName, capturePrefix,
+                recordFileName, recordBlocking, std::cout))
+                return 1;
+        }
+        catch (const std::exception& exc)
+        {
+            std::cerr << "Error: " << exc.what() << std::endl;
+            return 1;
+        }
+        first = false;
+    }
+    std::cout << std::endl << "]}" << std::endl;
+    return 0;
+}
@@ -7,18 +7,32 @@ BezierPatchMesh::BezierPatchMesh(
     const uint32_t numPatches,
     const float patchVertices[][3],
     const uint32_t subdivisionDegree,
-    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+    std::shared_ptr<DeviceMemoryPool> bufferPool,
+    std::shared_ptr<DeviceMemoryPool> stagingPool,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<MemoryTracker> memoryTracker /* nullptr */):
+    numPatches(numPatches)
 {
     assert(subdivisionDegree >= 2);
     assert(subdivisionDegree <= 32);
     const uint32_t divs = subdivisionDegree;
     const uint32_t vertexCount = (divs + 1) * (divs + 1);
-    std::shared_ptr<magma::SrcTransferBuffer> vertices(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float3)));
-    std::shared_ptr<magma::SrcTransferBuffer> normals(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float3)));
-    std::shared_ptr<magma::SrcTransferBuffer> texCoords(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float2)));
+    const uint32_t numFaces = divs * divs;
+    patchVertexCount = vertexCount;
+    indexCount = numFaces * 2 * 3;
+    const VkDeviceSize positionsSize = numPatches * vertexCount * sizeof(rapid::float3);
+    const VkDeviceSize normalsSize = numPatches * vertexCount * sizeof(rapid::float3);
+    const VkDeviceSize texCoordsSize = numPatches * vertexCount * sizeof(rapid::float2);
+    const VkDeviceSize indicesSize = indexCount * sizeof(uint32_t);
+    // All streams are staged in one buffer and uploaded with single submission
+    LinearAllocator stagingAllocator(positionsSize + normalsSize + texCoordsSize + indicesSize + 3 * 16);
+    const VkDeviceSize positionsOffset = stagingAllocator.allocate(positionsSize, 16);
+    const VkDeviceSize normalsOffset = stagingAllocator.allocate(normalsSize, 16);
+    const VkDeviceSize texCoordsOffset = stagingAllocator.allocate(texCoordsSize, 16);
+    const VkDeviceSize indicesOffset = stagingAllocator.allocate(indicesSize, 16);
+    std::shared_ptr<PooledBuffer> stagingBuffer = std::make_shared<PooledBuffer>(stagingPool,
+        stagingAllocator.getUsedBytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    uint8_t *staging = static_cast<uint8_t *>(stagingBuffer->getData());
     rapid::vector3 controlPoints[16];
     for (uint32_t np = 0; np < numPatches; ++np)
     {   // Set patch control points
@@ -28,9 +42,9 @@ BezierPatchMesh::BezierPatchMesh(
                                               patchVertices[patches[np][i] - 1][1],
                                               patchVertices[patches[np][i] - 1][2]);
         }
-        rapid::float3 *P = static_cast<rapid::float3 *>(vertices->getMemory()->map());
-        rapid::float3 *N = static_cast<rapid::float3 *>(normals->getMemory()->map());
-        rapid::float2 *st = static_cast<rapid::float2 *>(texCoords->getMemory()->map());
+        rapid::float3 *P = reinterpret_cast<rapid::float3 *>(staging + positionsOffset) + np * vertexCount;
+        rapid::float3 *N = reinterpret_cast<rapid::float3 *>(staging + normalsOffset) + np * vertexCount;
+        rapid::float2 *st = reinterpret_cast<rapid::float2 *>(staging + texCoordsOffset) + np * vertexCount;
         // Generate grid
         for (uint16_t j = 0, k = 0; j <= divs; ++j)
         {
@@ -52,52 +66,79 @@ BezierPatchMesh::BezierPatchMesh(
             std::swap(P[i].y, P[i].z);
             std::swap(N[i].y, N[i].z);
         }
-        texCoords->getMemory()->unmap();
-        normals->getMemory()->unmap();
-        vertices->getMemory()->unmap();
-        // Triangulate and load to buffers
-        std::shared_ptr<Patch> patch(std::make_shared<Patch>(cmdBuffer, vertices, normals, texCoords));
-        this->patches.push_back(patch);
     }
-    const uint32_t numFaces = divs * divs;
-    std::vector<uint32_t> indices(numFaces * 4);
+    std::vector<uint32_t> quads(numFaces * 4);
     // All patches are subdivided in the same way, so here we share the same topology
     for (uint16_t j = 0, k = 0; j < divs; ++j)
     {
         for (uint16_t i = 0; i < divs; ++i, ++k)
         {
-            indices[k * 4] = (divs + 1) * j + i;
-            indices[k * 4 + 1] = (divs + 1) * j + i + 1;
-            indices[k * 4 + 2] = (divs + 1) * (j + 1) + i + 1;
-            indices[k * 4 + 3] = (divs + 1) * (j + 1) + i;
+            quads[k * 4] = (divs + 1) * j + i;
+            quads[k * 4 + 1] = (divs + 1) * j + i + 1;
+            quads[k * 4 + 2] = (divs + 1) * (j + 1) + i + 1;
+            quads[k * 4 + 3] = (divs + 1) * (j + 1) + i;
         }
     }
-    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), numFaces * 2 * 3 * sizeof(uint32_t)));
-    magma::helpers::mapScoped<uint32_t>(srcBuffer, [numFaces, indices](uint32_t *faces)
+    uint32_t *faces = reinterpret_cast<uint32_t *>(staging + indicesOffset);
+    for (uint32_t i = 0, k = 0, n = 0; i < numFaces; ++i, k += 4) // For each face
     {
-        for (uint32_t i = 0, k = 0, n = 0; i < numFaces; ++i, k += 4) // For each face
+        for (uint32_t j = 0; j < 2; ++j) // For each triangle in the face
         {
-            for (uint32_t j = 0; j < 2; ++j) // For each triangle in the face
-            {
-                faces[n    ] = indices[k];
-                faces[n + 1] = indices[k + j + 1];
-                faces[n + 2] = indices[k + j + 2];
-                n += 3;
-            }
+            faces[n    ] = quads[k];
+            faces[n + 1] = quads[k + j + 1];
+            faces[n + 2] = quads[k + j + 2];
+            n += 3;
         }
-    });
-    indexBuffer = std::make_shared<magma::IndexBuffer>(cmdBuffer, srcBuffer, VK_INDEX_TYPE_UINT32);
-}
-
-void BezierPatchMesh::draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer) const
-{
-    cmdBuffer->bindIndexBuffer(indexBuffer);
-    for (const auto& patch : patches)
+    }
+    // Device-local buffers are sub-allocated from the same memory block
+    const VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    positions = std::make_shared<PooledBuffer>(bufferPool, positionsSize, vertexUsage);
+    normals = std::make_shared<PooledBuffer>(bufferPool, normalsSize, vertexUsage);
+    texCoords = std::make_shared<PooledBuffer>(bufferPool, texCoordsSize, vertexUsage);
+    indices = std::make_shared<PooledBuffer>(bufferPool, indicesSize,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    if (memoryTracker)
+    {   // Staging buffer is released at the end of constructor, after copies have finished
+        memoryTracker->add("mesh.staging", MemoryTag::Staging, stagingBuffer);
+        memoryTracker->add("mesh.positions", MemoryTag::Mesh, positions);
+        memoryTracker->add("mesh.normals", MemoryTag::Mesh, normals);
+        memoryTracker->add("mesh.texCoords", MemoryTag::Mesh, texCoords);
+        memoryTracker->add("mesh.indices", MemoryTag::Mesh, indices);
+    }
+    cmdBuffer->begin();
     {
-        cmdBuffer->bindVertexBuffers(0, {patch->vertexBuffer, patch->normalBuffer, patch->texCoordBuffer});
-        cmdBuffer->drawIndexed(indexBuffer->getIndexCount(), 0, 0);
+        const struct
+        {
+            const PooledBuffer& buffer;
+            VkDeviceSize srcOffset;
+        } copies[] = {
+            {*positions, positionsOffset},
+            {*normals, normalsOffset},
+            {*texCoords, texCoordsOffset},
+            {*indices, indicesOffset}
+        };
+        for (const auto& copy : copies)
+        {
+            const VkBufferCopy region = {copy.srcOffset, 0, copy.buffer.getSize()};
+            vkCmdCopyBuffer(*cmdBuffer, stagingBuffer->getHandle(), copy.buffer.getHandle(), 1, &region);
+        }
     }
+    cmdBuffer->end();
+    std::shared_ptr<magma::Device> device = cmdBuffer->getDevice();
+    std::shared_ptr<magma::Queue> queue = device->getQueue(VK_QUEUE_TRANSFER_BIT, 0);
+    std::shared_ptr<magma::Fence> fence = std::make_shared<magma::Fence>(device);
+    queue->submit(cmdBuffer, 0, nullptr, nullptr, fence);
+    fence->wait();
+}
+
+void BezierPatchMesh::draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t instanceCount /* 1 */) const
+{   // Bind once, patches are selected by vertex offset
+    const VkBuffer buffers[3] = {positions->getHandle(), normals->getHandle(), texCoords->getHandle()};
+    const VkDeviceSize offsets[3] = {0, 0, 0};
+    vkCmdBindVertexBuffers(*cmdBuffer, 0, 3, buffers, offsets);
+    vkCmdBindIndexBuffer(*cmdBuffer, indices->getHandle(), 0, VK_INDEX_TYPE_UINT32);
+    for (uint32_t np = 0; np < numPatches; ++np)
+        vkCmdDrawIndexed(*cmdBuffer, indexCount, instanceCount, 0, static_cast<int32_t>(np * patchVertexCount), 0);
 }
 
 const magma::VertexInputState& BezierPatchMesh::getVertexInput() const
@@ -115,13 +156,3 @@ const magma::VertexInputState& BezierPatchMesh::getVertexInput() const
     });
     return vertexInput;
 }
-
-BezierPatchMesh::Patch::Patch(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
-    std::shared_ptr<magma::SrcTransferBuffer> vertices,
-    std::shared_ptr<magma::SrcTransferBuffer> normals,
-    std::shared_ptr<magma::SrcTransferBuffer> texCoords)
-{
-    vertexBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, vertices);
-    normalBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, normals);
-    texCoordBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, texCoords);
-}
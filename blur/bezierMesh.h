@@ -1,5 +1,7 @@
 #pragma once
 #include "../magma/magma.h"
+#include "memoryPool.h"
+#include "memoryTracker.h"
 
 class BezierPatchMesh
 {
@@ -8,25 +10,20 @@ public:
         const uint32_t numPatches,
         const float patchVertices[][3],
         const uint32_t subdivisionDegree,
-        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
-    void draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer) const;
+        std::shared_ptr<DeviceMemoryPool> bufferPool,
+        std::shared_ptr<DeviceMemoryPool> stagingPool,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<MemoryTracker> memoryTracker = nullptr);
+    void draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t instanceCount = 1) const;
     const magma::VertexInputState& getVertexInput() const;
 
 private:
-    struct Patch;
-
-    std::vector<std::shared_ptr<Patch>> patches;
-    std::shared_ptr<magma::IndexBuffer> indexBuffer;
-};
-
-struct BezierPatchMesh::Patch
-{
-    Patch(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
-        std::shared_ptr<magma::SrcTransferBuffer> vertices,
-        std::shared_ptr<magma::SrcTransferBuffer> normals,
-        std::shared_ptr<magma::SrcTransferBuffer> texCoords);
-
-    std::shared_ptr<magma::VertexBuffer> vertexBuffer;
-    std::shared_ptr<magma::VertexBuffer> normalBuffer;
-    std::shared_ptr<magma::VertexBuffer> texCoordBuffer;
+    // Vertices of all patches are packed into single buffer per attribute
+    std::shared_ptr<PooledBuffer> positions;
+    std::shared_ptr<PooledBuffer> normals;
+    std::shared_ptr<PooledBuffer> texCoords;
+    std::shared_ptr<PooledBuffer> indices;
+    uint32_t numPatches;
+    uint32_t patchVertexCount;
+    uint32_t indexCount;
 };
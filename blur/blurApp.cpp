@@ -1,33 +1,58 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <sstream>
 #include <chrono>
-#include "vkApp.h"
+#include "blurApp.h"
 #include "bezierMesh.h"
-#include "../gliml/gliml.h"
+#include "separableBlur.h"
+#include "computeBlur.h"
+#include "kawaseBlur.h"
+#include "regions.h"
+#include "transformSystem.h"
+#include "barrier.h"
+#include "cpuBlur.h"
+#include "taskGraph.h"
+#include "renderGraph.h"
+#include "transientAttachment.h"
+#include "gaussianKernel.h"
+#include "ddsFormat.h"
 
 class BlurApp : public VkApp
 {
+    static constexpr uint32_t maxNaiveRadius = 8; // Number of weight constants in blur.frag
+    static constexpr uint32_t surfaceMaterialCount = 4; // SURFACE_MATERIALS in teapot.frag
+    static constexpr uint32_t bindlessMaterialCount = 64; // Any number, size of storage buffer
+    static constexpr uint32_t maxBindlessTextures = 16; // MAX_TEXTURES in teapotBindless.frag
+
     struct Framebuffer
     {
         std::shared_ptr<magma::ColorAttachment2D> color;
         std::shared_ptr<magma::ImageView> colorView;
-        std::shared_ptr<magma::DepthStencilAttachment2D> depth;
-        std::shared_ptr<magma::ImageView> depthView;
+        std::shared_ptr<TransientAttachment> depth;
         std::shared_ptr<magma::RenderPass> renderPass;
-        std::shared_ptr<magma::Framebuffer> framebuffer;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE; // Raw, as depth view is not magma object
     } fb;
 
     struct Texture
     {
         std::shared_ptr<magma::Image2D> image;
         std::shared_ptr<magma::ImageView> imageView;
+        // Staging data filled by readTexture() and released after upload
+        std::shared_ptr<magma::SrcTransferBuffer> buffer;
+        VkFormat format;
+        VkExtent2D extent;
+        magma::Image::MipmapLayout mipOffsets;
+        magma::Image::CopyLayout bufferLayout;
     } texture;
+    Texture plainTexture; // White, for untextured materials in bindless mode
 
     struct alignas(16) Transforms
     {
-        rapid::matrix normal;
-        rapid::matrix view;
-        rapid::matrix worldView;
-        rapid::matrix worldViewProj;
+        rapid::matrix view; // Lighting is computed in view space
     };
 
     struct alignas(16) Material
@@ -36,16 +61,28 @@ class BlurApp : public VkApp
         rapid::float4 diffuse;
         rapid::float3 specular;
         float shininess;
+        uint32_t textureIndex; // Into texture array in bindless mode
     };
 
+    const BlurSettings settings;
     std::unique_ptr<BezierPatchMesh> mesh;
     rapid::matrix view;
     rapid::matrix viewProj;
     std::chrono::high_resolution_clock::time_point oldTime;
+    float angle;
+    bool paused;
+    const bool bindless; // Materials and textures are selected from arrays by instance
+    const uint32_t materialCount; // Of surfaces
+    Transforms transforms; // Last written to uniform buffer
+    rapid::matrix model; // Animation shared by all instances
+    TransformSystem transformSystem;
 
     std::shared_ptr<magma::VertexBuffer> quad;
     std::shared_ptr<magma::UniformBuffer<Transforms>> uniformTransform;
     std::shared_ptr<magma::UniformBuffer<Material>> uniformMaterials;
+    std::shared_ptr<PooledBuffer> materialBuffer; // Used instead of uniform buffer in bindless mode
+    std::shared_ptr<PooledBuffer> instanceBuffer; // Mapped, one range per frame
+    VkDeviceSize instanceRangeSize;
     std::shared_ptr<magma::Sampler> textureSampler;
 
     std::shared_ptr<magma::DescriptorPool> descriptorPool;
@@ -58,28 +95,83 @@ class BlurApp : public VkApp
 
     std::shared_ptr<magma::GraphicsPipeline> checkerboardPipeline;
     std::shared_ptr<magma::GraphicsPipeline> teapotPipeline;
-    std::shared_ptr<magma::GraphicsPipeline> blitPipeline;
     std::shared_ptr<magma::GraphicsPipeline> blurPipeline;
+    std::map<std::pair<uint32_t, float>, std::shared_ptr<magma::GraphicsPipeline>> blurPipelines;
+    uint32_t blurRadius;
+    std::unique_ptr<SeparableBlur> separableBlur;
+    std::unique_ptr<ComputeBlur> computeBlur;
+    std::unique_ptr<KawaseBlur> kawaseBlur;
+    BlurMode blurMode; // Only blur of this mode is allocated
+    uint32_t pyramidLevels;
+    float pyramidOffset;
+
+    // Whole frame in one submission, variant is combination of passes that run
+    static constexpr uint32_t sceneVariant = 1; // Scene is rendered to fb.color
+    static constexpr uint32_t cacheVariant = 2; // Result is copied to cached frame
+    std::shared_ptr<magma::CommandBuffer> frameCommandBuffers[2][4];
+    std::shared_ptr<magma::RenderPass> regionRenderPass;
+    std::vector<VkRect2D> blurRegions;
+    std::vector<VkRect2D> copyRegions; // Unblurred area
+    uint32_t lastBufferIndex;
+
+    // Versions of inputs are bumped on change, rendered results remember versions they were made from
+    uint64_t sceneVersion; // Transforms, materials, texture
+    uint64_t blurVersion; // Blur technique and parameters
+    uint64_t offscreenVersion; // Of scene in fb.color
+    uint64_t cachedSceneVersion; // Of scene in cached frame
+    uint64_t cachedBlurVersion;
+    std::shared_ptr<magma::ColorAttachment2D> cachedFrame;
+    std::shared_ptr<magma::CommandBuffer> cachedBlitCommandBuffers[2];
+    uint64_t skippedOffscreenPasses;
+    uint64_t skippedBlurPasses;
 
-    std::shared_ptr<magma::CommandBuffer> offscreenCommandBuffer;
-    std::shared_ptr<magma::Semaphore> offscreenSemaphore;
+    uint32_t offscreenSection;
+    uint32_t blitSection;
+    uint32_t blurSection;
+    uint32_t blurHorizontalSection;
+    uint32_t blurComputeSection;
+    uint32_t blurPyramidSection;
+    uint32_t cacheUpdateSection;
+    uint32_t cachedBlitSection;
 
 public:
-    explicit BlurApp(HINSTANCE instance, HWND wnd, uint32_t width, uint32_t height):
-        VkApp(instance, wnd, width, height)
+    explicit BlurApp(const AppEntry& entry, const BlurSettings& settings):
+        VkApp(entry),
+        settings(settings),
+        angle(0.f),
+        paused(settings.paused),
+        bindless(settings.bindless && descriptorIndexing),
+        materialCount(bindless ? bindlessMaterialCount : surfaceMaterialCount),
+        instanceRangeSize(0),
+        blurMode(settings.mode),
+        blurRadius(settings.kernelSize/2),
+        pyramidLevels(settings.pyramidLevels),
+        pyramidOffset(settings.pyramidOffset),
+        lastBufferIndex(0),
+        sceneVersion(1),
+        blurVersion(1),
+        offscreenVersion(0),
+        cachedSceneVersion(0),
+        cachedBlurVersion(0),
+        skippedOffscreenPasses(0),
+        skippedBlurPasses(0)
     {
+        if (settings.bindless && !bindless)
+            debugOutput("Descriptor indexing is not supported, bindless mode is disabled\n");
+        memset(&transforms, 0, sizeof(Transforms));
+        memset(&model, 0, sizeof(rapid::matrix));
         createFramebuffer();
-        loadTexture("textures/stonewall.dds");
-        createQuadMesh();
-        createTeapotMesh();
-        createUniformBuffers();
-        createTextureSampler();
-        createDescriptorSets();
-        createCheckerboardPipeline();
-        createTeapotPipeline();
-        createBlitPipeline();
-        createBlurPipeline();
-        recordOffscreenCommandBuffer();
+        setupRegions();
+        createResources();
+        offscreenSection = profiler->addSection("offscreen");
+        blitSection = profiler->addSection("blit");
+        blurSection = profiler->addSection("blur");
+        blurHorizontalSection = profiler->addSection("blurHorizontal");
+        blurComputeSection = profiler->addSection("blurCompute");
+        blurPyramidSection = profiler->addSection("blurPyramid");
+        cacheUpdateSection = profiler->addSection("cacheUpdate");
+        cachedBlitSection = profiler->addSection("cachedBlit");
+        createFrameCache();
         recordCommandBuffer(0);
         recordCommandBuffer(1);
         setupMaterials();
@@ -87,36 +179,295 @@ public:
         oldTime = std::chrono::high_resolution_clock::now();
     }
 
+    ~BlurApp()
+    {   // Frames may still be in flight
+        device->waitIdle();
+        vkDestroyFramebuffer(*device, fb.framebuffer, hostAllocator->getCallbacks());
+    }
+
+    void createResources()
+    {   // Uploads share queue, so they are chained; everything else runs as soon as its inputs are ready.
+        TaskGraph graph;
+        const auto readTextureTask = graph.add("readTexture", [this]() { readTexture("textures/stonewall.dds"); });
+        const auto quadMeshTask = graph.add("createQuadMesh", [this]() { createQuadMesh(); });
+        const auto teapotMeshTask = graph.add("createTeapotMesh", [this]() { createTeapotMesh(); }, {quadMeshTask});
+        const auto uploadTextureTask = graph.add("uploadTexture", [this]() { uploadTexture(); }, {readTextureTask, teapotMeshTask});
+        const auto plainTextureTask = graph.add("createPlainTexture", [this]() { if (bindless) createPlainTexture(); }, {uploadTextureTask});
+        const auto instancesTask = graph.add("createInstanceBuffer", [this]() { createInstanceBuffer(); });
+        const auto uniformBuffersTask = graph.add("createUniformBuffers", [this]() { createUniformBuffers(); });
+        const auto textureSamplerTask = graph.add("createTextureSampler", [this]() { createTextureSampler(); });
+        const auto descriptorSetsTask = graph.add("createDescriptorSets", [this]() { createDescriptorSets(); },
+            {plainTextureTask, uniformBuffersTask, textureSamplerTask, instancesTask});
+        graph.add("createRegionRenderPass", [this]() { createRegionRenderPass(); });
+        graph.add("checkerboardPipeline", [this]() { createCheckerboardPipeline(); });
+        graph.add("teapotPipeline", [this]() { createTeapotPipeline(); }, {teapotMeshTask, descriptorSetsTask});
+        graph.add("blurPipeline", [this]() { blurPipeline = createBlurPipeline(blurRadius, defaultSigma); }, {descriptorSetsTask});
+        graph.add("createBlur", [this]() { createBlur(); }, {textureSamplerTask});
+        graph.run(*threadPool);
+        // All uploads have finished at this point
+        memoryTracker->warnLiveStaging();
+        std::ostringstream timings;
+        timings << "Startup tasks:" << std::endl;
+        graph.printTimings(timings);
+        const MemoryStatistics memory = bufferPool->getStatistics();
+        timings << "Pooled buffer memory: " << memory.allocationCount << " allocations in "
+            << memory.blockCount << " blocks, " << memory.usedBytes/1024 << " KiB used, "
+            << memory.wastedBytes/1024 << " KiB wasted, fragmentation " << memory.getFragmentation() << std::endl;
+        debugOutput(timings.str().c_str());
+    }
+
     void onRender(uint32_t bufferIndex) override
     {
         updatePerspectiveTransform();
-        queue->submit(offscreenCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            presentFinished, // Wait for swapchain
-            offscreenSemaphore,
-            nullptr);
-        queue->submit(commandBuffers[bufferIndex], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            offscreenSemaphore, // Wait for offscreen pass
+        lastBufferIndex = bufferIndex;
+        if (sceneVersion == cachedSceneVersion && blurVersion == cachedBlurVersion)
+        {   // Nothing has changed, re-present last frame
+            queue->submit(cachedBlitCommandBuffers[bufferIndex], VK_PIPELINE_STAGE_TRANSFER_BIT,
+                presentFinished, // Wait for swapchain
+                renderFinished,
+                waitFences[bufferIndex]);
+            for (uint32_t section : {offscreenSection, blitSection, blurSection, blurHorizontalSection,
+                blurComputeSection, blurPyramidSection, cacheUpdateSection})
+                profiler->skipSection(bufferIndex, section);
+            ++skippedOffscreenPasses;
+            ++skippedBlurPasses;
+            return;
+        }
+        profiler->skipSection(bufferIndex, cachedBlitSection);
+        const bool offscreenDirty = (sceneVersion != offscreenVersion);
+        if (offscreenDirty)
+        {
+            updateInstances(bufferIndex);
+            offscreenVersion = sceneVersion;
+        }
+        else
+        {   // Only blur parameters have changed
+            profiler->skipSection(bufferIndex, offscreenSection);
+            ++skippedOffscreenPasses;
+        }
+        // Inputs are expected to stay the same while animation is paused
+        const bool updateCache = paused;
+        const uint32_t variant = (offscreenDirty ? sceneVariant : 0) | (updateCache ? cacheVariant : 0);
+        // Swapchain image is first used by copy, passes before it don't wait for presentation
+        queue->submit(frameCommandBuffers[bufferIndex][variant], VK_PIPELINE_STAGE_TRANSFER_BIT,
+            presentFinished,
             renderFinished,
             waitFences[bufferIndex]);
+        if (updateCache)
+        {
+            cachedSceneVersion = sceneVersion;
+            cachedBlurVersion = blurVersion;
+        }
+        else
+            profiler->skipSection(bufferIndex, cacheUpdateSection);
     }
 
-private:
-    void setupMaterials()
+    void onKeyDown(char key, int repeat, uint32_t flags) override
     {
-        magma::helpers::mapScoped<Material>(uniformMaterials, true, [this](auto *materials)
+        switch (key)
         {
-            constexpr int light = 0;
-            constexpr int surface = 1;
+        case 'B': // Switch blur technique
+            switch (blurMode)
+            {
+            case BlurMode::Naive: blurMode = BlurMode::Separable; break;
+            case BlurMode::Separable: blurMode = BlurMode::Compute; break;
+            case BlurMode::Compute: blurMode = BlurMode::Pyramid; break;
+            default: blurMode = BlurMode::Naive;
+            }
+            device->waitIdle();
+            createBlur();
+            recordCommandBuffer(0);
+            recordCommandBuffer(1);
+            ++blurVersion;
+            break;
+        case 'U': // Increase blur radius
+            setBlurRadius(blurRadius + 1);
+            break;
+        case 'D': // Decrease blur radius
+            if (blurRadius > 0)
+                setBlurRadius(blurRadius - 1);
+            break;
+        case 'L': // Cycle number of pyramid levels
+            pyramidLevels = pyramidLevels % KawaseBlur::maxLevels + 1;
+            if (kawaseBlur)
+                kawaseBlur->setLevels(pyramidLevels);
+            device->waitIdle();
+            recordCommandBuffer(0);
+            recordCommandBuffer(1);
+            ++blurVersion;
+            break;
+        case 'O': // Cycle tap offset of pyramid passes
+            pyramidOffset = pyramidOffset < 3.f ? pyramidOffset + 0.5f : 0.5f;
+            if (kawaseBlur)
+            {   // Uniform buffer is read by frames in flight
+                device->waitIdle();
+                kawaseBlur->setOffset(pyramidOffset);
+            }
+            ++blurVersion;
+            break;
+        case 'P': // Pause animation
+            paused = !paused;
+            oldTime = std::chrono::high_resolution_clock::now();
+            break;
+        case 'M': // Print device memory report
+            {
+                std::ostringstream report;
+                memoryTracker->writeReport(report);
+                debugOutput(report.str().c_str());
+            }
+            break;
+        default:
+            VkApp::onKeyDown(key, repeat, flags);
+        }
+    }
 
-            materials[light].ambient = rapid::float4(0.25f, 0.25f, 0.25f, 0.f);
-            materials[light].diffuse = rapid::float4(1.0f, 0.9f, 0.8f, 0.f);
-            materials[light].specular = rapid::float3(1.0f, 0.8f, 0.5f);
+    void getSkippedPasses(uint64_t& offscreenPasses, uint64_t& blurPasses) const
+    {
+        offscreenPasses = skippedOffscreenPasses;
+        blurPasses = skippedBlurPasses;
+    }
 
-            materials[surface].ambient = rapid::float4(0.25f, 0.25f, 0.25f, 0.f);
-            materials[surface].diffuse = rapid::float4(1.f, 1.f, 1.f, 0.f);
-            materials[surface].specular = rapid::float3(1.f, 1.f, 1.f);
-            materials[surface].shininess = 4.0f; // Metallic
+    bool validate(double minPsnr, uint32_t maxError, std::ostream& log)
+    {
+        uint32_t radius;
+        switch (blurMode)
+        {
+        case BlurMode::Naive: radius = std::min(blurRadius, maxNaiveRadius); break;
+        case BlurMode::Separable: radius = separableBlur->getRadius(); break;
+        case BlurMode::Compute: radius = computeBlur->getRadius(); break;
+        default:
+            log << "pyramid blur is not Gaussian, validation skipped" << std::endl;
+            return true;
+        }
+        device->waitIdle();
+        // Source and result of the last rendered frame
+        const CpuImage source = readback(fb.color, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+        const bool bgra = (VK_FORMAT_B8G8R8A8_UNORM == colorFormat) || (VK_FORMAT_B8G8R8A8_SRGB == colorFormat);
+        const CpuImage result = readback(getFramebufferImage(lastBufferIndex),
+            headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, bgra);
+        CpuImage reference;
+        gaussianBlur(source, reference, radius, defaultSigma, *threadPool);
+        bool passed = true;
+        for (const VkRect2D& region : blurRegions)
+        {
+            const ImageDifference diff = compareImages(reference, result,
+                region.offset.x, region.offset.y, region.extent.width, region.extent.height);
+            log << "region " << region.extent.width << "x" << region.extent.height
+                << "+" << region.offset.x << "+" << region.offset.y
+                << ": PSNR " << diff.psnr << " dB, max error " << diff.maxError << std::endl;
+            if (diff.psnr < minPsnr || diff.maxError > maxError)
+                passed = false;
+        }
+        return passed;
+    }
+
+private:
+    CpuImage readback(std::shared_ptr<magma::Image> image, VkImageLayout layout, bool bgra)
+    {
+        const VkDeviceSize size = VkDeviceSize(width) * height * 4;
+        std::shared_ptr<magma::DstTransferBuffer> buffer = std::make_shared<magma::DstTransferBuffer>(device, size);
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer = std::make_shared<magma::PrimaryCommandBuffer>(commandPools[0]);
+        cmdBuffer->begin();
+        {
+            imageLayoutTransition(cmdBuffer, image, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+            copyImageToBuffer(cmdBuffer, image, VkExtent2D{width, height}, buffer);
+            hostReadBarrier(cmdBuffer, buffer);
+            imageLayoutTransition(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                0, 0);
+        }
+        cmdBuffer->end();
+        std::shared_ptr<magma::Fence> fence = std::make_shared<magma::Fence>(device);
+        queue->submit(cmdBuffer, 0, nullptr, nullptr, fence);
+        fence->wait();
+        CpuImage image2d;
+        image2d.width = width;
+        image2d.height = height;
+        image2d.pixels.resize(static_cast<size_t>(size));
+        magma::helpers::mapScoped<uint8_t>(buffer, [this, buffer, &image2d, bgra](uint8_t *data)
+        {   // No-op for coherent memory
+            const VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr,
+                *buffer->getMemory(), 0, VK_WHOLE_SIZE};
+            vkInvalidateMappedMemoryRanges(*device, 1, &range);
+            memcpy(image2d.pixels.data(), data, image2d.pixels.size());
+            if (bgra)
+            {
+                for (size_t i = 0; i < image2d.pixels.size(); i += 4)
+                    std::swap(image2d.pixels[i], image2d.pixels[i + 2]);
+            }
         });
+        return image2d;
+    }
+
+    void setBlurRadius(uint32_t radius)
+    {   // Kernels and pipeline are used by frames in flight
+        device->waitIdle();
+        blurRadius = radius;
+        if (separableBlur)
+            separableBlur->setKernel(radius, defaultSigma);
+        if (computeBlur)
+            computeBlur->setKernel(radius, defaultSigma);
+        // Naive kernel is baked into pipeline
+        blurPipeline = createBlurPipeline(radius, defaultSigma);
+        if (BlurMode::Naive == blurMode)
+        {
+            recordCommandBuffer(0);
+            recordCommandBuffer(1);
+        }
+        ++blurVersion;
+    }
+
+    void setupRegions()
+    {
+        const VkExtent2D extent{width, height};
+        if (settings.regions.empty())
+        {   // Blur right half of the screen
+            const uint32_t halfWidth = width >> 1;
+            blurRegions = {VkRect2D{{static_cast<int32_t>(halfWidth), 0}, {width - halfWidth, height}}};
+        }
+        else
+            blurRegions = clipRegions(settings.regions, extent);
+        copyRegions = subtractRegions(VkRect2D{{0, 0}, extent}, blurRegions);
+    }
+
+    void setupMaterials()
+    {
+        constexpr int light = 0;
+        constexpr int surface = 1;
+        std::vector<Material> materials(1 + materialCount);
+
+        materials[light].ambient = rapid::float4(0.25f, 0.25f, 0.25f, 0.f);
+        materials[light].diffuse = rapid::float4(1.0f, 0.9f, 0.8f, 0.f);
+        materials[light].specular = rapid::float3(1.0f, 0.8f, 0.5f);
+
+        // First one is used by single teapot, others tint instances
+        const rapid::float4 tints[surfaceMaterialCount] = {
+            rapid::float4(1.f, 1.f, 1.f, 0.f),
+            rapid::float4(1.f, 0.6f, 0.5f, 0.f),
+            rapid::float4(0.5f, 1.f, 0.6f, 0.f),
+            rapid::float4(0.6f, 0.7f, 1.f, 0.f)
+        };
+        for (uint32_t i = 0; i < materialCount; ++i)
+        {   // Beyond the first four, vary highlight and texture
+            const uint32_t variant = i / surfaceMaterialCount;
+            materials[surface + i].ambient = rapid::float4(0.25f, 0.25f, 0.25f, 0.f);
+            materials[surface + i].diffuse = tints[i % surfaceMaterialCount];
+            materials[surface + i].specular = rapid::float3(1.f, 1.f, 1.f);
+            materials[surface + i].shininess = 4.0f * (1 + variant); // Metallic
+            materials[surface + i].textureIndex = variant % 2; // Stone wall or plain
+        }
+        if (bindless)
+            memcpy(materialBuffer->getData(), materials.data(), materials.size() * sizeof(Material));
+        else
+        {
+            magma::helpers::mapScoped<Material>(uniformMaterials, true, [&materials](auto *data)
+            {
+                memcpy(data, materials.data(), materials.size() * sizeof(Material));
+            });
+        }
+        ++sceneVersion;
     }
 
     void setupView()
@@ -134,31 +485,48 @@ private:
 
     void updatePerspectiveTransform()
     {
-        static float angle = 0.f;
-
+        Profiler::ScopedSpan span(profiler.get(), "updatePerspectiveTransform");
         // Compute elapsed milliseconds
-        const auto curTime = std::chrono::high_resolution_clock::now();
-        const auto mcs = std::chrono::duration_cast<std::chrono::microseconds>(curTime - oldTime);
-        const float ms = static_cast<float>(mcs.count()) * 0.001f;
-        oldTime = curTime;
+        float ms = paused ? 0.f : settings.frameTime;
+        if (ms <= 0.f && !paused)
+        {
+            const auto curTime = std::chrono::high_resolution_clock::now();
+            const auto mcs = std::chrono::duration_cast<std::chrono::microseconds>(curTime - oldTime);
+            ms = static_cast<float>(mcs.count()) * 0.001f;
+            oldTime = curTime;
+        }
 
         angle += rapid::radians(ms * 0.03f);
         const rapid::matrix pitch = rapid::rotationX(angle);
         const rapid::matrix yaw = rapid::rotationY(angle);
         const rapid::matrix roll = rapid::rotationZ(angle);
         const rapid::matrix offset = rapid::translation(0.f, -1.5f, 0.f);
-        const rapid::matrix world = offset * pitch * yaw * roll;
-        const rapid::matrix worldView = world * view;
-        const rapid::matrix worldViewInv = rapid::inverse(worldView);
-        const rapid::matrix normal = rapid::transpose(worldViewInv);
+        const rapid::matrix newModel = offset * pitch * yaw * roll;
+        if (memcmp(&newModel, &model, sizeof(rapid::matrix)))
+        {   // Instances are rebuilt before offscreen pass
+            model = newModel;
+            ++sceneVersion;
+        }
 
-        magma::helpers::mapScoped<Transforms>(uniformTransform, true, [this, &normal, &world, &worldView](auto *transforms)
+        Transforms newTransforms;
+        newTransforms.view = view;
+        if (!memcmp(&newTransforms, &transforms, sizeof(Transforms)))
+            return;
+        transforms = newTransforms;
+        device->waitIdle(); // Uniform buffer is shared by frames in flight
+        magma::helpers::mapScoped<Transforms>(uniformTransform, true, [&newTransforms](auto *transforms)
         {
-            transforms->normal = normal; // Normal matrix used to transform objects-space normal in view space
-            transforms->view = this->view;
-            transforms->worldView = worldView;
-            transforms->worldViewProj = world * this->viewProj;
+            *transforms = newTransforms;
         });
+        ++sceneVersion;
+    }
+
+    void updateInstances(uint32_t bufferIndex)
+    {   // Range of previous use has been released by wait fence
+        Profiler::ScopedSpan span(profiler.get(), "updateInstances");
+        uint8_t *data = static_cast<uint8_t *>(instanceBuffer->getData()) + bufferIndex * instanceRangeSize;
+        transformSystem.update(model, view, viewProj,
+            reinterpret_cast<TransformSystem::Instance *>(data), threadPool.get());
     }
 
     void createFramebuffer()
@@ -169,41 +537,60 @@ private:
         fb.colorView = std::make_shared<magma::ImageView>(fb.color);
         // Create depth attachment
         const VkFormat depthFormat = getSupportedDepthFormat(physicalDevice, false, true);
-        fb.depth = std::make_shared<magma::DepthStencilAttachment2D>(device, depthFormat, extent, 1, 1);
-        fb.depthView = std::make_shared<magma::ImageView>(fb.depth);
+        fb.depth = std::make_shared<TransientAttachment>(device, physicalDevice, depthFormat, extent,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, hostAllocator->getCallbacks());
+        memoryTracker->add("fb.color", MemoryTag::Attachment, fb.color);
+        // Lazily allocated depth may take no memory at all on tiler
+        memoryTracker->add(fb.depth->isLazilyAllocated() ? "fb.depth (lazy)" : "fb.depth", MemoryTag::Attachment,
+            fb.depth, fb.depth->getMemorySize(), fb.depth->getMemoryType());
 
         // Define that color attachment don't care about clear, can store shader output and should be read-only image
         const magma::AttachmentDescription colorAttachment(fb.color->getFormat(), 1, magma::attachments::colorDontCareStoreShaderReadOnly);
-        // Define that depth attachment can be cleared and can store shader output
-        const magma::AttachmentDescription depthAttachment(fb.depth->getFormat(), 1, magma::attachments::depthClearStoreAttachment);
+        // Depth is only needed while teapot is drawn, so it is cleared and not written back to memory
+        const magma::AttachmentDescription depthAttachment(fb.depth->getFormat(), 1,
+            magma::op::clearDontCare,
+            magma::op::dontCare,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
         // Render pass defines attachment formats, load/store operations and final layouts
         fb.renderPass = std::shared_ptr<magma::RenderPass>(new magma::RenderPass(
             device, {colorAttachment, depthAttachment}));
         // Framebuffer defines render pass, color/depth/stencil image views and dimensions
-        fb.framebuffer = std::shared_ptr<magma::Framebuffer>(new magma::Framebuffer(
-            fb.renderPass, {fb.colorView, fb.depthView}));
+        const VkImageView attachments[2] = {*fb.colorView, fb.depth->getView()};
+        VkFramebufferCreateInfo framebufferInfo;
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.pNext = nullptr;
+        framebufferInfo.flags = 0;
+        framebufferInfo.renderPass = *fb.renderPass;
+        framebufferInfo.attachmentCount = 2;
+        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.width = width;
+        framebufferInfo.height = height;
+        framebufferInfo.layers = 1;
+        if (vkCreateFramebuffer(*device, &framebufferInfo, hostAllocator->getCallbacks(), &fb.framebuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to create framebuffer");
     }
 
-    VkFormat bcFormat(const gliml::context& ctx)
+    // Doesn't use command buffers, so may run concurrently with other uploads
+    void readTexture(const std::string& filename)
     {
-        const int internalFormat = ctx.image_internal_format();
-        switch (internalFormat)
-        {
-        case GLIML_GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
-            return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
-        case GLIML_GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
-            return VK_FORMAT_BC2_UNORM_BLOCK;
-        case GLIML_GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-            return VK_FORMAT_BC3_UNORM_BLOCK;
-        default:
-            throw std::invalid_argument("unknown block compressed format");
-            return VK_FORMAT_UNDEFINED;
+        const AssetEntry *asset = assetPackage ? assetPackage->find(filename.c_str()) : nullptr;
+        if (asset && AssetType::Texture == asset->type)
+        {   // Mip chain is already laid out by packer, copy it from mapped pages
+            texture.buffer = std::make_shared<magma::SrcTransferBuffer>(device, asset->size);
+            memoryTracker->add("texture.staging", MemoryTag::Staging, texture.buffer,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            magma::helpers::mapScoped<uint8_t>(texture.buffer, [&](uint8_t *data)
+            {
+                memcpy(data, assetPackage->getData(*asset), static_cast<size_t>(asset->size));
+            });
+            texture.format = static_cast<VkFormat>(asset->format);
+            texture.extent = {asset->width, asset->height};
+            texture.mipOffsets.assign(asset->mipOffsets, asset->mipOffsets + asset->mipLevels);
+            texture.bufferLayout = magma::Image::CopyLayout{0, 0, 0};
+            return;
         }
-    }
-
-    void loadTexture(const std::string& filename)
-    {
         std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
         if (!file.is_open())
             throw std::runtime_error("failed to open file \"" + filename + "\"");
@@ -211,8 +598,10 @@ private:
         file.seekg(0, std::ios::beg);
         gliml::context ctx;
         VkDeviceSize baseMipOffset = 0;
-        std::shared_ptr<magma::SrcTransferBuffer> buffer = std::make_shared<magma::SrcTransferBuffer>(device, size);
-        magma::helpers::mapScoped<uint8_t>(buffer, [&](uint8_t *data)
+        texture.buffer = std::make_shared<magma::SrcTransferBuffer>(device, size);
+        memoryTracker->add("texture.staging", MemoryTag::Staging, texture.buffer,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        magma::helpers::mapScoped<uint8_t>(texture.buffer, [&](uint8_t *data)
         {   // Read data to buffer
             file.read(reinterpret_cast<char *>(data), size);
             file.close();
@@ -223,19 +612,41 @@ private:
             baseMipOffset = reinterpret_cast<const uint8_t *>(ctx.image_data(0, 0)) - data;
         });
         // Setup texture data description
-        const VkFormat format = bcFormat(ctx);
-        const VkExtent2D extent = {static_cast<uint32_t>(ctx.image_width(0, 0)), static_cast<uint32_t>(ctx.image_height(0, 0))};
-        magma::Image::MipmapLayout mipOffsets(1, 0);
+        texture.format = bcFormat(ctx);
+        texture.extent = {static_cast<uint32_t>(ctx.image_width(0, 0)), static_cast<uint32_t>(ctx.image_height(0, 0))};
+        texture.mipOffsets.assign(1, 0);
         for (int level = 1; level < ctx.num_mipmaps(0); ++level)
         {   // Compute relative offset
             const intptr_t mipOffset = (const uint8_t *)ctx.image_data(0, level) - (const uint8_t *)ctx.image_data(0, level - 1);
-            mipOffsets.push_back(mipOffset);
+            texture.mipOffsets.push_back(mipOffset);
         }
-        // Upload texture data from buffer
-        magma::Image::CopyLayout bufferLayout{baseMipOffset, 0, 0};
-        texture.image = std::make_shared<magma::Image2D>(cmdImageCopy, format, extent, buffer, mipOffsets, bufferLayout);
+        texture.bufferLayout = magma::Image::CopyLayout{baseMipOffset, 0, 0};
+    }
+
+    void uploadTexture()
+    {   // Upload texture data from buffer
+        texture.image = std::make_shared<magma::Image2D>(cmdImageCopy, texture.format, texture.extent,
+            texture.buffer, texture.mipOffsets, texture.bufferLayout);
+        texture.buffer.reset();
+        memoryTracker->add("texture", MemoryTag::Texture, texture.image);
         // Create image view for shader
         texture.imageView = std::make_shared<magma::ImageView>(texture.image);
+        ++sceneVersion;
+    }
+
+    void createPlainTexture()
+    {   // White texels keep color of material as is
+        constexpr VkExtent2D extent{4, 4};
+        constexpr VkDeviceSize size = extent.width * extent.height * 4;
+        std::shared_ptr<magma::SrcTransferBuffer> buffer = std::make_shared<magma::SrcTransferBuffer>(device, size);
+        magma::helpers::mapScoped<uint8_t>(buffer, [](uint8_t *data)
+        {
+            memset(data, 0xFF, static_cast<size_t>(size));
+        });
+        plainTexture.image = std::make_shared<magma::Image2D>(cmdImageCopy, VK_FORMAT_R8G8B8A8_UNORM, extent,
+            buffer, magma::Image::MipmapLayout(1, 0), magma::Image::CopyLayout{0, 0, 0});
+        memoryTracker->add("plainTexture", MemoryTag::Texture, plainTexture.image);
+        plainTexture.imageView = std::make_shared<magma::ImageView>(plainTexture.image);
     }
 
     void createQuadMesh()
@@ -244,19 +655,59 @@ private:
             {-1.f, -1.f}, {-1.f, 1.f}, {1.f, -1.f}, {1.f, 1.f}
         };
         quad = std::make_shared<magma::VertexBuffer>(cmdBufferCopy, vertices);
+        memoryTracker->add("quad", MemoryTag::Mesh, quad, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     }
 
     void createTeapotMesh()
     {
 #       include "teapot.h"
-        constexpr uint32_t subdivisionDegree = 16;
-        mesh = std::make_unique<BezierPatchMesh>(teapotPatches, kTeapotNumPatches, teapotVertices, subdivisionDegree, cmdBufferCopy);
+        mesh = std::make_unique<BezierPatchMesh>(teapotPatches, kTeapotNumPatches, teapotVertices, settings.subdivisionDegree,
+            bufferPool, stagingPool, cmdBufferCopy, memoryTracker);
+    }
+
+    void createInstanceBuffer()
+    {   // Grid of scaled down copies in front of camera, single instance is left as is
+        const uint32_t instanceCount = std::max(settings.instanceCount, 1U);
+        const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+        const uint32_t rows = (instanceCount + columns - 1)/columns;
+        const float scale = 1.f/columns;
+        constexpr float gridSize = 7.f; // Fits into view frustum at the origin
+        const float cellSize = gridSize * scale;
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            const float x = (i % columns - (columns - 1) * 0.5f) * cellSize;
+            const float y = (i / columns - (rows - 1) * 0.5f) * cellSize;
+            // Turn around vertical axis by golden angle, so neighbours differ
+            const float halfAngle = (instanceCount > 1) ? i * 1.2f : 0.f;
+            transformSystem.add(x, y, 0.f, 0.f, std::sin(halfAngle), 0.f, std::cos(halfAngle),
+                scale, i % materialCount);
+        }
+        // Dynamic offsets must be aligned to minStorageBufferOffsetAlignment, which is at most 256
+        constexpr VkDeviceSize offsetAlignment = 256;
+        const VkDeviceSize size = transformSystem.getPaddedCount() * sizeof(TransformSystem::Instance);
+        instanceRangeSize = (size + offsetAlignment - 1) & ~(offsetAlignment - 1);
+        instanceBuffer = std::make_shared<PooledBuffer>(stagingPool, instanceRangeSize * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        memoryTracker->add("instances", MemoryTag::Storage, instanceBuffer);
     }
 
     void createUniformBuffers()
     {
         uniformTransform = std::make_shared<magma::UniformBuffer<Transforms>>(device);
-        uniformMaterials = std::make_shared<magma::UniformBuffer<Material>>(device, 2); // Allocate two materials
+        memoryTracker->add("uniformTransform", MemoryTag::Uniform, uniformTransform,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        // Light and surfaces
+        if (bindless)
+        {
+            materialBuffer = std::make_shared<PooledBuffer>(stagingPool, (1 + materialCount) * sizeof(Material),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            memoryTracker->add("materials", MemoryTag::Storage, materialBuffer);
+        }
+        else
+        {
+            uniformMaterials = std::make_shared<magma::UniformBuffer<Material>>(device, 1 + materialCount);
+            memoryTracker->add("uniformMaterials", MemoryTag::Uniform, uniformMaterials,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
     }
 
     void createTextureSampler()
@@ -269,25 +720,62 @@ private:
     {
         constexpr magma::Descriptor oneUniformBuffer = magma::descriptors::UniformBuffer(1);
         constexpr magma::Descriptor oneImageSampler = magma::descriptors::CombinedImageSampler(1);
+        constexpr magma::Descriptor oneDynamicStorageBuffer = magma::descriptors::DynamicStorageBuffer(1);
 
         constexpr uint32_t maxDescriptorSets = 2;
         descriptorPool = std::shared_ptr<magma::DescriptorPool>(new magma::DescriptorPool(device, maxDescriptorSets,
             {
                 magma::descriptors::UniformBuffer(2),
-                magma::descriptors::CombinedImageSampler(2)
+                magma::descriptors::CombinedImageSampler(1 + maxBindlessTextures),
+                magma::descriptors::StorageBuffer(1),
+                magma::descriptors::DynamicStorageBuffer(1)
             }));
 
-        // Create pipeline layout for teapot drawing
+        // Create pipeline layout for teapot drawing. In bindless mode all materials
+        // and textures are visible through single set, so draws don't rebind it.
+        const magma::Descriptor materials = bindless ? magma::descriptors::StorageBuffer(1) : oneUniformBuffer;
+        const magma::Descriptor textures = magma::descriptors::CombinedImageSampler(bindless ? maxBindlessTextures : 1);
         teapotDescriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
             std::initializer_list<magma::DescriptorSetLayout::Binding>{
-                magma::bindings::VertexFragmentStageBinding(0, oneUniformBuffer),
-                magma::bindings::FragmentStageBinding(1, oneUniformBuffer),
-                magma::bindings::FragmentStageBinding(2, oneImageSampler)
+                magma::bindings::FragmentStageBinding(0, oneUniformBuffer),
+                magma::bindings::FragmentStageBinding(1, materials),
+                magma::bindings::FragmentStageBinding(2, textures),
+                magma::bindings::VertexStageBinding(3, oneDynamicStorageBuffer)
             });
         teapotDescriptorSet = descriptorPool->allocateDescriptorSet(teapotDescriptorSetLayout);
         teapotDescriptorSet->update(0, uniformTransform);
-        teapotDescriptorSet->update(1, uniformMaterials);
-        teapotDescriptorSet->update(2, texture.imageView, textureSampler);
+        // Pooled buffers and texture array are written directly, offset of frame is given at bind time
+        VkDescriptorBufferInfo instanceInfo;
+        instanceInfo.buffer = instanceBuffer->getHandle();
+        instanceInfo.offset = 0;
+        instanceInfo.range = transformSystem.getPaddedCount() * sizeof(TransformSystem::Instance);
+        VkDescriptorBufferInfo materialInfo;
+        VkDescriptorImageInfo textureInfos[maxBindlessTextures];
+        std::vector<VkWriteDescriptorSet> writes;
+        writes.push_back(descriptorWrite(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1));
+        writes.back().pBufferInfo = &instanceInfo;
+        if (bindless)
+        {
+            materialInfo.buffer = materialBuffer->getHandle();
+            materialInfo.offset = 0;
+            materialInfo.range = materialBuffer->getSize();
+            writes.push_back(descriptorWrite(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1));
+            writes.back().pBufferInfo = &materialInfo;
+            for (uint32_t i = 0; i < maxBindlessTextures; ++i)
+            {   // Every element is written, so array doesn't need to be partially bound
+                textureInfos[i].sampler = *textureSampler;
+                textureInfos[i].imageView = (1 == i) ? *plainTexture.imageView : *texture.imageView;
+                textureInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            }
+            writes.push_back(descriptorWrite(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxBindlessTextures));
+            writes.back().pImageInfo = textureInfos;
+        }
+        else
+        {
+            teapotDescriptorSet->update(1, uniformMaterials);
+            teapotDescriptorSet->update(2, texture.imageView, textureSampler);
+        }
+        vkUpdateDescriptorSets(*device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
         teapotPipelineLayout = std::make_shared<magma::PipelineLayout>(teapotDescriptorSetLayout);
 
         // Create pipeline layout for blur post-effect
@@ -298,6 +786,17 @@ private:
         blurPipelineLayout = std::make_shared<magma::PipelineLayout>(blurDescriptorSetLayout);
     }
 
+    VkWriteDescriptorSet descriptorWrite(uint32_t binding, VkDescriptorType type, uint32_t count) const
+    {
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = *teapotDescriptorSet;
+        write.dstBinding = binding;
+        write.descriptorCount = count;
+        write.descriptorType = type;
+        return write;
+    }
+
     void createCheckerboardPipeline()
     {
         checkerboardPipeline = std::make_shared<magma::GraphicsPipeline>(device,
@@ -326,7 +825,7 @@ private:
         teapotPipeline = std::make_shared<magma::GraphicsPipeline>(device,
             std::vector<magma::PipelineShaderStage>{
                 loadShader("shaders/transform.o"),
-                loadShader("shaders/teapot.o")
+                loadShader(bindless ? "shaders/teapotBindless.o" : "shaders/teapot.o")
             },
             mesh->getVertexInput(),
             magma::renderstates::triangleList,
@@ -344,12 +843,49 @@ private:
             nullptr, nullptr, 0);
     }
 
-    void createBlitPipeline()
+    void createRegionRenderPass()
+    {   // Compatible with swapchain framebuffers, but loads image that was copied before the pass
+        const magma::AttachmentDescription colorAttachment(colorFormat, 1,
+            magma::op::loadStore,
+            magma::op::dontCare,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        regionRenderPass = std::shared_ptr<magma::RenderPass>(new magma::RenderPass(
+            device, {colorAttachment}));
+    }
+
+    std::shared_ptr<magma::GraphicsPipeline> createBlurPipeline(uint32_t radius, float sigma)
     {
-        blitPipeline = std::make_shared<magma::GraphicsPipeline>(device,
+        radius = std::min(radius, maxNaiveRadius);
+        auto it = blurPipelines.find(std::make_pair(radius, sigma));
+        if (it != blurPipelines.end())
+            return it->second;
+        // Weights are normalized on the host, unused ones are zero
+        struct Constants
+        {
+            int32_t radius;
+            float weights[maxNaiveRadius + 1];
+        } constants = {static_cast<int32_t>(radius), {}};
+        const std::vector<float> weights = gaussianWeights(radius, sigma);
+        for (uint32_t i = 0; i <= radius; ++i)
+            constants.weights[i] = weights[radius + i];
+        std::shared_ptr<magma::Specialization> specialization(std::make_shared<magma::Specialization>(constants,
+            std::initializer_list<magma::SpecializationEntry>{
+                magma::SpecializationEntry(0, offsetof(Constants, radius), sizeof(int32_t)),
+                magma::SpecializationEntry(1, offsetof(Constants, weights[0]), sizeof(float)),
+                magma::SpecializationEntry(2, offsetof(Constants, weights[1]), sizeof(float)),
+                magma::SpecializationEntry(3, offsetof(Constants, weights[2]), sizeof(float)),
+                magma::SpecializationEntry(4, offsetof(Constants, weights[3]), sizeof(float)),
+                magma::SpecializationEntry(5, offsetof(Constants, weights[4]), sizeof(float)),
+                magma::SpecializationEntry(6, offsetof(Constants, weights[5]), sizeof(float)),
+                magma::SpecializationEntry(7, offsetof(Constants, weights[6]), sizeof(float)),
+                magma::SpecializationEntry(8, offsetof(Constants, weights[7]), sizeof(float)),
+                magma::SpecializationEntry(9, offsetof(Constants, weights[8]), sizeof(float))
+            }));
+        std::shared_ptr<magma::GraphicsPipeline> pipeline = std::make_shared<magma::GraphicsPipeline>(device,
             std::vector<magma::PipelineShaderStage>{
                 loadShader("shaders/passthrough.o"),
-                loadShader("shaders/blit.o")
+                loadShader("shaders/blur.o", specialization)
             },
             magma::renderstates::pos2f,
             magma::renderstates::triangleStrip,
@@ -365,91 +901,311 @@ private:
             renderPass, 0,
             pipelineCache,
             nullptr, nullptr, 0);
+        blurPipelines[std::make_pair(radius, sigma)] = pipeline;
+        return pipeline;
     }
 
-    void createBlurPipeline()
+    void createSeparableBlur()
     {
-        blurPipeline = std::make_shared<magma::GraphicsPipeline>(device,
+        separableBlur = std::make_unique<SeparableBlur>(fb.colorView, VkExtent2D{width, height}, boundingRect(blurRegions),
+            textureSampler, renderPass,
             std::vector<magma::PipelineShaderStage>{
                 loadShader("shaders/passthrough.o"),
-                loadShader("shaders/blur.o")
-            },
-            magma::renderstates::pos2f,
-            magma::renderstates::triangleStrip,
-            magma::renderstates::fillCullNoneCW,
-            magma::renderstates::dontMultisample,
-            magma::renderstates::depthAlwaysDontWrite,
-            magma::renderstates::dontBlendRgb,
-            std::initializer_list<VkDynamicState>{
-                VK_DYNAMIC_STATE_VIEWPORT,
-                VK_DYNAMIC_STATE_SCISSOR
+                loadShader("shaders/blurSeparable.o")
             },
-            blurPipelineLayout,
-            renderPass, 0,
-            pipelineCache,
-            nullptr, nullptr, 0);
+            pipelineCache);
+        separableBlur->setKernel(blurRadius, defaultSigma);
+        separableBlur->trackMemory(*memoryTracker);
+    }
+
+    void createComputeBlur()
+    {
+        computeBlur = std::make_unique<ComputeBlur>(fb.colorView, boundingRect(blurRegions),
+            textureSampler,
+            loadShader("shaders/blurCompute.o"),
+            pipelineCache);
+        computeBlur->setKernel(blurRadius, defaultSigma);
+        computeBlur->trackMemory(*memoryTracker);
+    }
+
+    void createKawaseBlur()
+    {
+        kawaseBlur = std::make_unique<KawaseBlur>(fb.colorView, VkExtent2D{width, height},
+            textureSampler, renderPass,
+            loadShader("shaders/passthrough.o"),
+            loadShader("shaders/kawaseDown.o"),
+            loadShader("shaders/kawaseUp.o"),
+            pipelineCache);
+        kawaseBlur->setLevels(pyramidLevels);
+        kawaseBlur->setOffset(pyramidOffset);
+        kawaseBlur->trackMemory(*memoryTracker);
     }
 
-    void recordOffscreenCommandBuffer()
+    void createBlur()
+    {   // Blur modes never run in the same frame, so intermediate images of inactive ones
+        // are released before the active one is allocated. Expects device to be idle.
+        if (blurMode != BlurMode::Separable)
+            separableBlur.reset();
+        if (blurMode != BlurMode::Compute)
+            computeBlur.reset();
+        if (blurMode != BlurMode::Pyramid)
+            kawaseBlur.reset();
+        if (BlurMode::Separable == blurMode && !separableBlur)
+            createSeparableBlur();
+        else if (BlurMode::Compute == blurMode && !computeBlur)
+            createComputeBlur();
+        else if (BlurMode::Pyramid == blurMode && !kawaseBlur)
+            createKawaseBlur();
+    }
+
+    void createFrameCache()
     {
-        offscreenSemaphore = std::make_shared<magma::Semaphore>(device);
-        offscreenCommandBuffer = std::make_shared<magma::PrimaryCommandBuffer>(commandPools[0]);
-        offscreenCommandBuffer->begin();
+        cachedFrame = std::make_shared<magma::ColorAttachment2D>(device, colorFormat, VkExtent2D{width, height}, 1, 1);
+        memoryTracker->add("cachedFrame", MemoryTag::Attachment, cachedFrame);
+        const VkRect2D screen = {{0, 0}, {width, height}};
+        const VkImageLayout finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        for (uint32_t index = 0; index < 2; ++index)
         {
-            offscreenCommandBuffer->beginRenderPass(fb.renderPass, fb.framebuffer,
-                {
-                    // Only elements corresponding to cleared attachments are used. Other elements of pClearValues are ignored.
-                    magma::clears::blackColor,
-                    magma::clears::depthOne
-                });
+            std::shared_ptr<magma::Image> target = getFramebufferImage(index);
+            // Present cached frame instead of rendering
+            std::shared_ptr<magma::CommandBuffer> cmdBuffer = std::make_shared<magma::PrimaryCommandBuffer>(commandPools[0]);
+            cmdBuffer->begin();
             {
-                offscreenCommandBuffer->setViewport(0, 0, width, height);
-                offscreenCommandBuffer->setScissor(0, 0, width, height);
-                // Draw checkerboard
-                offscreenCommandBuffer->bindPipeline(checkerboardPipeline);
-                offscreenCommandBuffer->bindVertexBuffer(0, quad);
-                offscreenCommandBuffer->draw(4, 0);
-                // Draw teapot mesh
-                offscreenCommandBuffer->bindDescriptorSet(teapotPipeline, teapotDescriptorSet);
-                offscreenCommandBuffer->bindPipeline(teapotPipeline);
-                mesh->draw(offscreenCommandBuffer);
+                profiler->resetSections(cmdBuffer, index, cachedBlitSection, 1);
+                profiler->beginSection(cmdBuffer, index, cachedBlitSection);
+                imageLayoutTransition(cmdBuffer, target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0, VK_ACCESS_TRANSFER_WRITE_BIT);
+                blitImage(cmdBuffer, cachedFrame, screen, target, screen);
+                imageLayoutTransition(cmdBuffer, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+                profiler->endSection(cmdBuffer, index, cachedBlitSection);
             }
-            offscreenCommandBuffer->endRenderPass();
+            cmdBuffer->end();
+            cachedBlitCommandBuffers[index] = cmdBuffer;
         }
-        offscreenCommandBuffer->end();
     }
 
     void recordCommandBuffer(uint32_t index)
+    {   // Each combination of skipped passes has its own command buffer, so steady frame records nothing
+        for (uint32_t variant = 0; variant < 4; ++variant)
+        {
+            std::shared_ptr<magma::CommandBuffer> cmdBuffer = std::make_shared<magma::PrimaryCommandBuffer>(commandPools[0]);
+            cmdBuffer->begin();
+            {
+                for (uint32_t section : {offscreenSection, blitSection, blurSection, blurHorizontalSection,
+                    blurComputeSection, blurPyramidSection, cacheUpdateSection})
+                    profiler->resetSections(cmdBuffer, index, section, 1);
+                RenderGraph graph;
+                buildFrameGraph(graph, index, variant);
+                graph.record(cmdBuffer);
+            }
+            cmdBuffer->end();
+            frameCommandBuffers[index][variant] = cmdBuffer;
+        }
+    }
+
+    void buildFrameGraph(RenderGraph& graph, uint32_t index, uint32_t variant)
     {
-        const uint32_t halfWidth = width >> 1;
+        std::shared_ptr<magma::Image> target = getFramebufferImage(index);
+        const VkImageLayout finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Scene is kept in fb.color between frames if offscreen pass is skipped
+        const RenderGraph::Resource color = graph.importImage("fb.color", fb.color,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        const RenderGraph::Resource screen = graph.importImage("target", target, VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
+        graph.markOutput(screen);
+        const RenderGraph::Pass scenePass = graph.addPass("offscreen", {RenderGraph::colorAttachment(color)},
+            [this, index](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+            {
+                profiler->beginSection(cmdBuffer, index, offscreenSection);
+                // Only elements corresponding to cleared attachments are used. Other elements of pClearValues are ignored.
+                VkClearValue clearValues[2];
+                clearValues[0].color = {{0.f, 0.f, 0.f, 1.f}};
+                clearValues[1].depthStencil = {1.f, 0};
+                VkRenderPassBeginInfo beginInfo;
+                beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                beginInfo.pNext = nullptr;
+                beginInfo.renderPass = *fb.renderPass;
+                beginInfo.framebuffer = fb.framebuffer;
+                beginInfo.renderArea = {{0, 0}, {width, height}};
+                beginInfo.clearValueCount = 2;
+                beginInfo.pClearValues = clearValues;
+                vkCmdBeginRenderPass(*cmdBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+                {
+                    cmdBuffer->setViewport(0, 0, width, height);
+                    cmdBuffer->setScissor(0, 0, width, height);
+                    // Draw checkerboard
+                    cmdBuffer->bindPipeline(checkerboardPipeline);
+                    cmdBuffer->bindVertexBuffer(0, quad);
+                    cmdBuffer->draw(4, 0);
+                    // Draw teapot mesh
+                    const VkDescriptorSet descriptorSet = *teapotDescriptorSet;
+                    const uint32_t instanceOffset = static_cast<uint32_t>(index * instanceRangeSize);
+                    vkCmdBindDescriptorSets(*cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *teapotPipelineLayout,
+                        0, 1, &descriptorSet, 1, &instanceOffset);
+                    cmdBuffer->bindPipeline(teapotPipeline);
+                    mesh->draw(cmdBuffer, transformSystem.getCount());
+                }
+                vkCmdEndRenderPass(*cmdBuffer);
+                profiler->endSection(cmdBuffer, index, offscreenSection);
+            });
+        graph.setEnabled(scenePass, (variant & sceneVariant) != 0);
 
-        std::shared_ptr<magma::CommandBuffer> cmdBuffer = commandBuffers[index];
-        cmdBuffer->begin();
-        {
-            cmdBuffer->beginRenderPass(renderPass, framebuffers[index], {/* don't clear */});
+        // Blur passes are culled if there is nothing to blur
+        RenderGraph::Resource blurred = color;
+        if (BlurMode::Separable == blurMode)
+        {   // Horizontal pass of blurred regions
+            blurred = graph.importImage("separableBlur.intermediate", separableBlur->getIntermediate(),
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+            graph.addPass("blurHorizontal", {RenderGraph::sampled(color), RenderGraph::colorAttachment(blurred)},
+                [this, index](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                {
+                    profiler->beginSection(cmdBuffer, index, blurHorizontalSection);
+                    separableBlur->horizontalPass(cmdBuffer, quad, blurRegions);
+                    profiler->endSection(cmdBuffer, index, blurHorizontalSection);
+                });
+        }
+        else if (BlurMode::Compute == blurMode)
+        {   // Blur bounds of regions to storage image
+            blurred = graph.importImage("computeBlur.result", computeBlur->getResult(),
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+            graph.addPass("blurCompute",
+                {RenderGraph::sampled(color, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), RenderGraph::storageWrite(blurred)},
+                [this, index](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                {
+                    profiler->beginSection(cmdBuffer, index, blurComputeSection);
+                    computeBlur->dispatch(cmdBuffer, boundingRect(blurRegions));
+                    profiler->endSection(cmdBuffer, index, blurComputeSection);
+                });
+        }
+        else if (BlurMode::Pyramid == blurMode)
+        {   // Downsample whole image and upsample back, blurred regions are composed in render pass
+            const uint32_t levels = kawaseBlur->getLevels();
+            RenderGraph::Resource pyramid[KawaseBlur::maxLevels];
+            for (uint32_t level = 0; level < levels; ++level)
             {
-                cmdBuffer->setViewport(0, 0, width, height);
-                cmdBuffer->bindVertexBuffer(0, quad);
-
-                // Blit left half of the screen
-                cmdBuffer->setScissor(0, 0, halfWidth, height);
-                cmdBuffer->bindDescriptorSet(blitPipeline, blurDescriptorSet);
-                cmdBuffer->bindPipeline(blitPipeline);
-                cmdBuffer->draw(4);
-
-                // Blur right half of the screen
-                cmdBuffer->setScissor(halfWidth, 0, width, height);
-                cmdBuffer->bindDescriptorSet(blurPipeline, blurDescriptorSet);
-                cmdBuffer->bindPipeline(blurPipeline);
-                cmdBuffer->draw(4);
+                pyramid[level] = graph.importImage("kawaseBlur.level", kawaseBlur->getLevelImage(level),
+                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
             }
-            cmdBuffer->endRenderPass();
+            for (uint32_t level = 0; level < levels; ++level)
+            {
+                graph.addPass("blurDownsample",
+                    {RenderGraph::sampled(level ? pyramid[level - 1] : color), RenderGraph::colorAttachment(pyramid[level])},
+                    [this, index, level, levels](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                    {
+                        if (0 == level)
+                            profiler->beginSection(cmdBuffer, index, blurPyramidSection);
+                        kawaseBlur->downsample(cmdBuffer, quad, level);
+                        if (1 == levels)
+                            profiler->endSection(cmdBuffer, index, blurPyramidSection);
+                    });
+            }
+            for (uint32_t level = levels - 1; level > 0; --level)
+            {
+                graph.addPass("blurUpsample",
+                    {RenderGraph::sampled(pyramid[level]), RenderGraph::colorAttachment(pyramid[level - 1])},
+                    [this, index, level](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                    {
+                        kawaseBlur->upsample(cmdBuffer, quad, level);
+                        if (1 == level)
+                            profiler->endSection(cmdBuffer, index, blurPyramidSection);
+                    });
+            }
+            blurred = pyramid[0];
+        }
+
+        // Copy unblurred area without going through fragment shader
+        std::vector<RenderGraph::Access> copyAccesses = {RenderGraph::transferRead(color), RenderGraph::transferWrite(screen)};
+        if (BlurMode::Compute == blurMode && !blurRegions.empty())
+            copyAccesses.push_back(RenderGraph::transferRead(blurred));
+        graph.addPass("blit", std::move(copyAccesses),
+            [this, index, target](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+            {
+                profiler->beginSection(cmdBuffer, index, blitSection);
+                for (const VkRect2D& region : copyRegions)
+                    blitImage(cmdBuffer, fb.color, region, target, region);
+                profiler->endSection(cmdBuffer, index, blitSection);
+                if (BlurMode::Compute == blurMode)
+                {   // Already blurred, just copy
+                    const VkOffset2D origin = computeBlur->getOrigin();
+                    profiler->beginSection(cmdBuffer, index, blurSection);
+                    for (const VkRect2D& region : blurRegions)
+                    {
+                        const VkRect2D srcRect = {{region.offset.x - origin.x, region.offset.y - origin.y}, region.extent};
+                        blitImage(cmdBuffer, computeBlur->getResult(), srcRect, target, region);
+                    }
+                    profiler->endSection(cmdBuffer, index, blurSection);
+                }
+            });
+        if (blurMode != BlurMode::Compute && !blurRegions.empty())
+        {   // Render pass loads copied image and transitions it to present layout
+            graph.addPass("blur", {RenderGraph::loadColorAttachment(screen, finalLayout), RenderGraph::sampled(blurred)},
+                [this, index](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                {
+                    cmdBuffer->beginRenderPass(regionRenderPass, framebuffers[index], {/* don't clear */});
+                    {
+                        cmdBuffer->setViewport(0, 0, width, height);
+                        profiler->beginSection(cmdBuffer, index, blurSection);
+                        for (const VkRect2D& region : blurRegions)
+                        {
+                            cmdBuffer->setScissor(region.offset.x, region.offset.y, region.extent.width, region.extent.height);
+                            if (BlurMode::Separable == blurMode)
+                                separableBlur->verticalPass(cmdBuffer, quad);
+                            else if (BlurMode::Pyramid == blurMode)
+                                kawaseBlur->compose(cmdBuffer, quad);
+                            else
+                            {
+                                cmdBuffer->bindVertexBuffer(0, quad);
+                                cmdBuffer->bindDescriptorSet(blurPipeline, blurDescriptorSet);
+                                cmdBuffer->bindPipeline(blurPipeline);
+                                cmdBuffer->draw(4);
+                            }
+                        }
+                        profiler->endSection(cmdBuffer, index, blurSection);
+                    }
+                    cmdBuffer->endRenderPass();
+                });
+        }
+        if (variant & cacheVariant)
+        {   // Copy of rendered frame to cache
+            const RenderGraph::Resource cache = graph.importImage("cachedFrame", cachedFrame,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            graph.markOutput(cache);
+            graph.addPass("cacheUpdate", {RenderGraph::transferRead(screen), RenderGraph::transferWrite(cache)},
+                [this, index, target](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+                {
+                    const VkRect2D rect = {{0, 0}, {width, height}};
+                    profiler->beginSection(cmdBuffer, index, cacheUpdateSection);
+                    blitImage(cmdBuffer, target, rect, cachedFrame, rect);
+                    profiler->endSection(cmdBuffer, index, cacheUpdateSection);
+                });
         }
-        cmdBuffer->end();
     }
 };
 
-std::unique_ptr<VkApp> createVulkanApp(HINSTANCE instance, HWND wnd, uint32_t width, uint32_t height)
+std::unique_ptr<VkApp> createBlurApp(const AppEntry& entry, const BlurSettings& settings)
+{
+    return std::make_unique<BlurApp>(entry, settings);
+}
+
+void getSkippedPasses(VkApp *app, uint64_t& offscreenPasses, uint64_t& blurPasses)
+{
+    BlurApp *blurApp = dynamic_cast<BlurApp *>(app);
+    if (!blurApp)
+        throw std::invalid_argument("not a blur application");
+    blurApp->getSkippedPasses(offscreenPasses, blurPasses);
+}
+
+bool validateBlur(VkApp *app, double minPsnr, uint32_t maxError, std::ostream& log)
+{
+    BlurApp *blurApp = dynamic_cast<BlurApp *>(app);
+    if (!blurApp)
+        throw std::invalid_argument("not a blur application");
+    return blurApp->validate(minPsnr, maxError, log);
+}
+
+std::unique_ptr<VkApp> createVulkanApp(const AppEntry& entry)
 {
-    return std::make_unique<BlurApp>(instance, wnd, width, height);
+    return createBlurApp(entry, BlurSettings());
 }
@@ -0,0 +1,32 @@
+#pragma once
+#include <ostream>
+#include <vector>
+#include "vkApp.h"
+
+enum class BlurMode : uint32_t
+{
+    Naive, // Single pass gather of MxM taps
+    Separable, // Horizontal and vertical passes with bilinear taps
+    Compute, // Both passes in compute shader from shared memory tile
+    Pyramid // Dual Kawase downsample/upsample chain
+};
+
+struct BlurSettings
+{
+    BlurMode mode = BlurMode::Separable;
+    uint32_t kernelSize = 7; // Number of taps in each dimension, should be odd (up to 17 in naive mode)
+    uint32_t pyramidLevels = 4; // Number of half resolution levels in pyramid mode
+    float pyramidOffset = 1.f; // Tap distance of pyramid passes in half texels
+    uint32_t subdivisionDegree = 16; // Bezier patch tessellation
+    uint32_t instanceCount = 1; // Copies of teapot on a grid, drawn with instanced draws
+    bool bindless = false; // Many materials and textures indexed by instance (if VK_EXT_descriptor_indexing is supported)
+    float frameTime = 0.f; // Fixed animation step in milliseconds, or zero to use real time
+    bool paused = false; // Unchanged frames are presented from cache without rendering
+    std::vector<VkRect2D> regions; // Screen rectangles to blur, or empty to blur right half
+};
+
+std::unique_ptr<VkApp> createBlurApp(const AppEntry& entry, const BlurSettings& settings);
+// Number of offscreen and blur passes skipped because their inputs didn't change
+void getSkippedPasses(VkApp *app, uint64_t& offscreenPasses, uint64_t& blurPasses);
+// Compares blurred regions of the last rendered frame with CPU reference blur
+bool validateBlur(VkApp *app, double minPsnr, uint32_t maxError, std::ostream& log);
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstring>
+#include "computeBlur.h"
+#include "gaussianKernel.h"
+#include "memoryTracker.h"
+
+ComputeBlur::ComputeBlur(std::shared_ptr<magma::ImageView> imageView,
+    const VkRect2D& bounds,
+    std::shared_ptr<magma::Sampler> sampler,
+    const magma::PipelineShaderStage& shaderStage,
+    std::shared_ptr<magma::PipelineCache> pipelineCache):
+    bounds(bounds),
+    radius(0),
+    sigma(defaultSigma),
+    region(bounds)
+{
+    std::shared_ptr<magma::Device> device = imageView->getDevice();
+    const VkExtent2D extent = {std::max(bounds.extent.width, 1U), std::max(bounds.extent.height, 1U)};
+    result = std::make_shared<magma::StorageImage2D>(device, VK_FORMAT_R8G8B8A8_UNORM, extent, 1);
+    resultView = std::make_shared<magma::ImageView>(result);
+    kernel = std::make_shared<magma::UniformBuffer<Kernel>>(device);
+    updateKernel();
+
+    constexpr magma::Descriptor oneImageSampler = magma::descriptors::CombinedImageSampler(1);
+    constexpr magma::Descriptor oneStorageImage = magma::descriptors::StorageImage(1);
+    constexpr magma::Descriptor oneUniformBuffer = magma::descriptors::UniformBuffer(1);
+    constexpr uint32_t maxDescriptorSets = 1;
+    descriptorPool = std::shared_ptr<magma::DescriptorPool>(new magma::DescriptorPool(device, maxDescriptorSets,
+        {
+            oneImageSampler,
+            oneStorageImage,
+            oneUniformBuffer
+        }));
+    descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        std::initializer_list<magma::DescriptorSetLayout::Binding>{
+            magma::bindings::ComputeStageBinding(0, oneImageSampler),
+            magma::bindings::ComputeStageBinding(1, oneStorageImage),
+            magma::bindings::ComputeStageBinding(2, oneUniformBuffer)
+        });
+    descriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+    descriptorSet->update(0, imageView, sampler);
+    descriptorSet->update(1, resultView);
+    descriptorSet->update(2, kernel);
+    pipelineLayout = std::make_shared<magma::PipelineLayout>(descriptorSetLayout);
+    pipeline = std::make_shared<magma::ComputePipeline>(device, shaderStage, pipelineLayout, pipelineCache);
+}
+
+void ComputeBlur::setKernel(uint32_t radius, float sigma)
+{
+    radius = std::min(radius, maxRadius);
+    if (radius != this->radius || sigma != this->sigma)
+    {
+        this->radius = radius;
+        this->sigma = sigma;
+        updateKernel();
+    }
+}
+
+void ComputeBlur::updateKernel()
+{
+    const std::vector<float> weights = gaussianWeights(radius, sigma);
+    magma::helpers::mapScoped<Kernel>(kernel, true, [this, &weights](auto *kernel)
+    {
+        kernel->region[0] = region.offset.x;
+        kernel->region[1] = region.offset.y;
+        kernel->region[2] = static_cast<int32_t>(region.extent.width);
+        kernel->region[3] = static_cast<int32_t>(region.extent.height);
+        kernel->origin[0] = bounds.offset.x;
+        kernel->origin[1] = bounds.offset.y;
+        kernel->radius = static_cast<int32_t>(this->radius);
+        for (uint32_t i = 0; i <= this->radius; ++i) // Symmetric
+            kernel->weights[i] = rapid::float4(weights[this->radius + i], 0.f, 0.f, 0.f);
+    });
+}
+
+void ComputeBlur::dispatch(std::shared_ptr<magma::CommandBuffer> cmdBuffer, const VkRect2D& region)
+{
+    if (memcmp(&this->region, &region, sizeof(VkRect2D)))
+    {   // Region is stored in uniform buffer
+        this->region = region;
+        updateKernel();
+    }
+    cmdBuffer->bindPipeline(pipeline);
+    cmdBuffer->bindDescriptorSet(pipeline, descriptorSet);
+    const uint32_t groupCountX = (region.extent.width + tileSize - 1) / tileSize;
+    const uint32_t groupCountY = (region.extent.height + tileSize - 1) / tileSize;
+    cmdBuffer->dispatch(groupCountX, groupCountY, 1);
+}
+
+void ComputeBlur::trackMemory(MemoryTracker& tracker) const
+{
+    tracker.add("computeBlur.result", MemoryTag::Attachment, result);
+    tracker.add("computeBlur.kernel", MemoryTag::Uniform, kernel,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "../magma/magma.h"
+#include "../rapid/rapid.h"
+
+class MemoryTracker;
+
+// Gaussian blur in compute shader. Each workgroup loads tile with apron
+// into shared memory once, then runs horizontal and vertical passes from it.
+// Result is written to storage image covering only bounds of blurred regions,
+// from which it is blitted to the screen.
+class ComputeBlur
+{
+public:
+    static constexpr uint32_t tileSize = 16;
+    static constexpr uint32_t maxRadius = 16;
+
+    explicit ComputeBlur(std::shared_ptr<magma::ImageView> imageView,
+        const VkRect2D& bounds,
+        std::shared_ptr<magma::Sampler> sampler,
+        const magma::PipelineShaderStage& shaderStage,
+        std::shared_ptr<magma::PipelineCache> pipelineCache);
+    void setKernel(uint32_t radius, float sigma);
+    uint32_t getRadius() const { return radius; }
+    // Region should be inside of bounds. Result is expected in general layout,
+    // transitions before and after are recorded by caller.
+    void dispatch(std::shared_ptr<magma::CommandBuffer> cmdBuffer, const VkRect2D& region);
+    std::shared_ptr<magma::Image> getResult() const { return result; }
+    VkOffset2D getOrigin() const { return bounds.offset; }
+    void trackMemory(MemoryTracker& tracker) const;
+
+private:
+    struct alignas(16) Kernel
+    {
+        int32_t region[4];
+        int32_t origin[2];
+        int32_t radius;
+        int32_t pad;
+        rapid::float4 weights[maxRadius + 1];
+    };
+
+    void updateKernel();
+
+    VkRect2D bounds;
+    uint32_t radius;
+    float sigma;
+    VkRect2D region;
+    std::shared_ptr<magma::StorageImage2D> result;
+    std::shared_ptr<magma::ImageView> resultView;
+    std::shared_ptr<magma::UniformBuffer<Kernel>> kernel;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> descriptorSetLayout;
+    std::shared_ptr<magma::DescriptorSet> descriptorSet;
+    std::shared_ptr<magma::PipelineLayout> pipelineLayout;
+    std::shared_ptr<magma::ComputePipeline> pipeline;
+};
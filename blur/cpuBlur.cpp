@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "cpuBlur.h"
+#include "gaussianKernel.h"
+#include "threadPool.h"
+
+namespace
+{
+inline uint32_t clampIndex(int32_t i, uint32_t size)
+{
+    return static_cast<uint32_t>(std::min(std::max(i, 0), static_cast<int32_t>(size) - 1));
+}
+
+// Filters one row of RGBA8 pixels into RGBA32F
+void horizontalRow(const uint8_t *src, float *dst, uint32_t width, const std::vector<float>& weights, uint32_t radius)
+{
+    const int32_t r = static_cast<int32_t>(radius);
+    const int32_t w = static_cast<int32_t>(width);
+    int32_t x = 0;
+    auto scalarPixel = [&](int32_t x)
+    {
+        float sum[4] = {0.f, 0.f, 0.f, 0.f};
+        for (int32_t k = -r; k <= r; ++k)
+        {
+            const uint8_t *texel = src + clampIndex(x + k, width) * 4;
+            const float weight = weights[k + r];
+            for (int c = 0; c < 4; ++c)
+                sum[c] += texel[c] * weight;
+        }
+        for (int c = 0; c < 4; ++c)
+            dst[x * 4 + c] = sum[c];
+    };
+    // Left edge needs clamping
+    for (; x < std::min(r, w); ++x)
+        scalarPixel(x);
+#ifdef __AVX2__
+    // Two pixels per iteration while all taps are inside of the row
+    for (; x + 1 + r < w; x += 2)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (int32_t k = -r; k <= r; ++k)
+        {
+            const __m128i texels = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + (x + k) * 4));
+            const __m256 color = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(texels));
+            const __m256 weight = _mm256_set1_ps(weights[k + r]);
+#ifdef __FMA__
+            sum = _mm256_fmadd_ps(color, weight, sum);
+#else
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(color, weight));
+#endif
+        }
+        _mm256_storeu_ps(dst + x * 4, sum);
+    }
+#endif // __AVX2__
+    for (; x < w; ++x)
+        scalarPixel(x);
+}
+
+// Filters columns of RGBA32F rows into one row of RGBA8 pixels
+void verticalRow(const float *src, uint8_t *dst, uint32_t width, uint32_t height, uint32_t y,
+    const std::vector<float>& weights, uint32_t radius)
+{
+    const int32_t r = static_cast<int32_t>(radius);
+    const uint32_t count = width * 4;
+    const size_t pitch = count;
+    uint32_t i = 0;
+#ifdef __AVX2__
+    // Eight channels per iteration
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (int32_t k = -r; k <= r; ++k)
+        {
+            const float *row = src + clampIndex(static_cast<int32_t>(y) + k, height) * pitch;
+            const __m256 color = _mm256_loadu_ps(row + i);
+            const __m256 weight = _mm256_set1_ps(weights[k + r]);
+#ifdef __FMA__
+            sum = _mm256_fmadd_ps(color, weight, sum);
+#else
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(color, weight));
+#endif
+        }
+        // Round to nearest as UNORM conversion does, then saturate to bytes
+        const __m256i rounded = _mm256_cvtps_epi32(sum);
+        const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(words, words));
+    }
+#endif // __AVX2__
+    if (i < count)
+    {   // Accumulate whole rows so that compiler can vectorize inner loop
+        thread_local std::vector<float> sum;
+        sum.assign(count - i, 0.f);
+        for (int32_t k = -r; k <= r; ++k)
+        {
+            const float *row = src + clampIndex(static_cast<int32_t>(y) + k, height) * pitch + i;
+            const float weight = weights[k + r];
+            for (size_t j = 0; j < sum.size(); ++j)
+                sum[j] += row[j] * weight;
+        }
+        for (size_t j = 0; j < sum.size(); ++j)
+            dst[i + j] = static_cast<uint8_t>(std::min(std::max(sum[j] + 0.5f, 0.f), 255.f));
+    }
+}
+} // namespace
+
+void gaussianBlur(const CpuImage& src, CpuImage& dst, uint32_t radius, float sigma, ThreadPool& threadPool)
+{
+    const std::vector<float> weights = gaussianWeights(radius, sigma);
+    const size_t pitch = src.width * 4;
+    std::vector<float> intermediate(pitch * src.height);
+    dst.width = src.width;
+    dst.height = src.height;
+    dst.pixels.resize(src.pixels.size());
+    threadPool.parallelFor(src.height, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; ++y)
+            horizontalRow(src.pixels.data() + y * pitch, intermediate.data() + y * pitch, src.width, weights, radius);
+    });
+    threadPool.parallelFor(src.height, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; ++y)
+            verticalRow(intermediate.data(), dst.pixels.data() + y * pitch, src.width, src.height, y, weights, radius);
+    });
+}
+
+ImageDifference compareImages(const CpuImage& a, const CpuImage& b,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    if (a.width != b.width || a.height != b.height)
+        throw std::invalid_argument("images have different dimensions");
+    const uint32_t right = std::min(x + width, a.width);
+    const uint32_t bottom = std::min(y + height, a.height);
+    double squaredError = 0.;
+    uint64_t count = 0;
+    ImageDifference difference = {std::numeric_limits<double>::infinity(), 0};
+    for (uint32_t j = y; j < bottom; ++j)
+    {
+        for (uint32_t i = x; i < right; ++i)
+        {
+            const size_t offset = (size_t(j) * a.width + i) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int32_t error = std::abs(a.pixels[offset + c] - b.pixels[offset + c]);
+                difference.maxError = std::max(difference.maxError, static_cast<uint32_t>(error));
+                squaredError += error * error;
+            }
+            count += 3;
+        }
+    }
+    if (count && squaredError > 0.)
+    {
+        const double mse = squaredError/count;
+        difference.psnr = 10. * std::log10(255. * 255./mse);
+    }
+    return difference;
+}
+
+CpuImage loadPpm(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open file \"" + filename + "\"");
+    std::string magic;
+    uint32_t maxValue = 0;
+    CpuImage image;
+    file >> magic >> image.width >> image.height >> maxValue;
+    if (magic != "P6" || maxValue != 255 || !image.width || !image.height)
+        throw std::runtime_error("\"" + filename + "\" is not 8-bit binary PPM");
+    file.get(); // Single whitespace before pixel data
+    std::vector<uint8_t> rgb(size_t(image.width) * image.height * 3);
+    if (!file.read(reinterpret_cast<char *>(rgb.data()), rgb.size()))
+        throw std::runtime_error("unexpected end of file \"" + filename + "\"");
+    image.pixels.resize(size_t(image.width) * image.height * 4);
+    for (size_t i = 0, j = 0; i < rgb.size(); i += 3, j += 4)
+    {
+        image.pixels[j] = rgb[i];
+        image.pixels[j + 1] = rgb[i + 1];
+        image.pixels[j + 2] = rgb[i + 2];
+        image.pixels[j + 3] = 255;
+    }
+    return image;
+}
+
+void savePpm(const std::string& filename, const CpuImage& image)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to create file \"" + filename + "\"");
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+    std::vector<uint8_t> rgb(size_t(image.width) * image.height * 3);
+    for (size_t i = 0, j = 0; i < rgb.size(); i += 3, j += 4)
+    {
+        rgb[i] = image.pixels[j];
+        rgb[i + 1] = image.pixels[j + 1];
+        rgb[i + 2] = image.pixels[j + 2];
+    }
+    file.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+}
+
+namespace
+{
+uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static const std::vector<uint32_t> table = []()
+    {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeChunk(std::ofstream& file, const char *type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> header;
+    putBigEndian(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    uint32_t crc = crc32(0, header.data() + 4, 4);
+    crc = crc32(crc, data.data(), data.size());
+    std::vector<uint8_t> footer;
+    putBigEndian(footer, crc);
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+}
+} // namespace
+
+void savePng(const std::string& filename, const CpuImage& image)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to create file \"" + filename + "\"");
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+    std::vector<uint8_t> header;
+    putBigEndian(header, image.width);
+    putBigEndian(header, image.height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, deflate, no filter, no interlace
+    writeChunk(file, "IHDR", header);
+    // Each row starts with filter type (none)
+    const size_t rowSize = size_t(image.width) * 4;
+    std::vector<uint8_t> rows;
+    rows.reserve((rowSize + 1) * image.height);
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        rows.push_back(0);
+        rows.insert(rows.end(), image.pixels.begin() + y * rowSize, image.pixels.begin() + (y + 1) * rowSize);
+    }
+    // Zlib stream of stored blocks
+    constexpr size_t maxBlockSize = 65535;
+    std::vector<uint8_t> compressed;
+    compressed.reserve(rows.size() + rows.size()/maxBlockSize * 5 + 16);
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+    uint32_t a = 1, b = 0; // Adler-32
+    size_t offset = 0;
+    do
+    {
+        const size_t size = std::min(maxBlockSize, rows.size() - offset);
+        const bool last = (offset + size == rows.size());
+        compressed.push_back(last ? 1 : 0);
+        compressed.push_back(static_cast<uint8_t>(size));
+        compressed.push_back(static_cast<uint8_t>(size >> 8));
+        compressed.push_back(static_cast<uint8_t>(~size));
+        compressed.push_back(static_cast<uint8_t>(~size >> 8));
+        compressed.insert(compressed.end(), rows.begin() + offset, rows.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; ++i)
+        {
+            a = (a + rows[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        offset += size;
+    } while (offset < rows.size());
+    putBigEndian(compressed, (b << 16) | a);
+    writeChunk(file, "IDAT", compressed);
+    writeChunk(file, "IEND", {});
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// RGBA8 image in CPU memory, rows are tightly packed
+struct CpuImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+struct ImageDifference
+{
+    double psnr; // In dB, infinity for identical images
+    uint32_t maxError; // Largest absolute difference of color channel
+};
+
+// Separable Gaussian with the same radius/sigma semantics and
+// clamp-to-edge addressing as GPU blur. Uses AVX2 if compiled with -mavx2.
+void gaussianBlur(const CpuImage& src, CpuImage& dst, uint32_t radius, float sigma, ThreadPool& threadPool);
+// Compares RGB channels of rectangle, alpha is ignored
+ImageDifference compareImages(const CpuImage& a, const CpuImage& b,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+// Binary PPM (P6) used for captured frames, alpha is set to opaque on load
+CpuImage loadPpm(const std::string& filename);
+void savePpm(const std::string& filename, const CpuImage& image);
+// RGBA PNG with stored (uncompressed) deflate blocks, no zlib needed
+void savePng(const std::string& filename, const CpuImage& image);
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cpuBlur.h"
+#include "gaussianKernel.h"
+#include "threadPool.h"
+
+// Software fallback of blur for captured frames, doesn't need Vulkan:
+//   cpublur --kernel 7 --sigma 4 --threads 8 frame0.ppm blurred0.ppm frame1.ppm blurred1.ppm
+
+int main(int argc, char *argv[])
+{
+    uint32_t kernelSize = 7;
+    float sigma = defaultSigma;
+    uint32_t threadCount = 0;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if ("--kernel" == arg && hasValue)
+            kernelSize = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--sigma" == arg && hasValue)
+            sigma = static_cast<float>(atof(argv[++i]));
+        else if ("--threads" == arg && hasValue)
+            threadCount = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg.compare(0, 2, "--") != 0)
+            files.push_back(arg);
+        else
+            files.clear();
+    }
+    if (files.empty() || files.size() % 2)
+    {
+        std::cerr << "usage: " << argv[0] << " [--kernel M] [--sigma S] [--threads N] input.ppm output.ppm ..." << std::endl;
+        return 1;
+    }
+
+    ThreadPool threadPool(threadCount);
+    try
+    {
+        for (size_t i = 0; i < files.size(); i += 2)
+        {
+            const CpuImage source = loadPpm(files[i]);
+            CpuImage result;
+            const auto begin = std::chrono::high_resolution_clock::now();
+            gaussianBlur(source, result, kernelSize/2, sigma, threadPool);
+            const auto end = std::chrono::high_resolution_clock::now();
+            savePpm(files[i + 1], result);
+            std::cout << files[i] << ": " << std::chrono::duration<double, std::milli>(end - begin).count()
+                << " ms on " << threadPool.getThreadCount() << " threads" << std::endl;
+        }
+    }
+    catch (const std::exception& exc)
+    {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include <cstring>
+#include "embeddedShaders.h"
+
+#ifdef EMBED_SHADERS
+// Generated by Makefile from glslangValidator --vn output
+#include "shaders/embeddedIncludes.inc"
+
+#define EMBEDDED_SHADER(name) {"shaders/" #name ".o", name##Spirv, sizeof(name##Spirv)},
+
+static const EmbeddedShader embeddedShaders[] = {
+#include "shaders/embeddedTable.inc"
+};
+
+const EmbeddedShader *findEmbeddedShader(const char *fileName)
+{
+    for (const EmbeddedShader& shader : embeddedShaders)
+    {
+        if (!strcmp(shader.fileName, fileName))
+            return &shader;
+    }
+    return nullptr;
+}
+#else
+const EmbeddedShader *findEmbeddedShader(const char *)
+{
+    return nullptr;
+}
+#endif // EMBED_SHADERS
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// SPIR-V compiled into executable (make EMBED_SHADERS=1)
+struct EmbeddedShader
+{
+    const char *fileName;
+    const uint32_t *bytecode;
+    size_t size; // In bytes
+};
+
+// Returns nullptr if shaders aren't embedded or there is no such file
+const EmbeddedShader *findEmbeddedShader(const char *fileName);
@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include "frameCapture.h"
+#include "barrier.h"
+#include "cpuBlur.h"
+#include "memoryTracker.h"
+#include "platform.h"
+
+FrameCapture::FrameCapture(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::CommandPool> commandPool,
+    const VkExtent2D& extent, bool bgra,
+    uint32_t slotCount /* 3 */,
+    std::shared_ptr<MemoryTracker> memoryTracker /* nullptr */):
+    device(std::move(device)),
+    commandPool(std::move(commandPool)),
+    extent(extent),
+    bgra(bgra),
+    next(0),
+    worker(std::make_unique<ThreadPool>(1))
+{
+    const VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+    for (uint32_t i = 0; i < slotCount; ++i)
+    {
+        std::unique_ptr<Slot> slot = std::make_unique<Slot>();
+        slot->buffer = std::make_shared<magma::DstTransferBuffer>(this->device, size);
+        slot->fence = std::make_shared<magma::Fence>(this->device);
+        slot->cmdBuffer = std::make_shared<magma::PrimaryCommandBuffer>(this->commandPool);
+        slot->state = Free;
+        if (memoryTracker)
+            memoryTracker->add("capture" + std::to_string(i), MemoryTag::Staging, slot->buffer,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        slots.push_back(std::move(slot));
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    flush();
+    worker.reset();
+}
+
+bool FrameCapture::capture(std::shared_ptr<magma::Queue> queue,
+    std::shared_ptr<magma::Image> image, VkImageLayout layout,
+    std::shared_ptr<magma::Semaphore> waitSemaphore,
+    std::shared_ptr<magma::Semaphore> signalSemaphore,
+    const std::string& fileName, bool record /* false */)
+{
+    record = record && stream;
+    Slot *slot = slots[next].get();
+    if (slot->state != Free)
+    {   // Worker or GPU lags behind
+        if (!record || !stream->isBlocking())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++statistics.droppedCount;
+            return false;
+        }
+        const auto begin = std::chrono::high_resolution_clock::now();
+        if (Copying == slot->state)
+        {
+            slot->fence->wait();
+            retire(slot);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFreed.wait(lock, [slot]() { return Free == slot->state; });
+        const auto end = std::chrono::high_resolution_clock::now();
+        statistics.stallMs += std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+    const auto begin = std::chrono::high_resolution_clock::now();
+    next = (next + 1) % static_cast<uint32_t>(slots.size());
+    slot->fileName = fileName;
+    slot->record = record;
+    // Slot is free, so its command buffer has executed and is reset by begin()
+    slot->cmdBuffer->begin();
+    {   // Headless frame has no semaphore, so rendering writes are made available here
+        imageLayoutTransition(slot->cmdBuffer, image, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        copyImageToBuffer(slot->cmdBuffer, image, extent, slot->buffer);
+        hostReadBarrier(slot->cmdBuffer, slot->buffer);
+        imageLayoutTransition(slot->cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0);
+    }
+    slot->cmdBuffer->end();
+    slot->fence->reset();
+    queue->submit(slot->cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        waitSemaphore,
+        signalSemaphore,
+        slot->fence);
+    slot->state = Copying;
+    const auto end = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.recordMs += std::chrono::duration<double, std::milli>(end - begin).count();
+    return true;
+}
+
+void FrameCapture::poll()
+{
+    for (auto& slot : slots)
+    {
+        if (Copying == slot->state && VK_SUCCESS == vkGetFenceStatus(*device, *slot->fence))
+            retire(slot.get());
+    }
+}
+
+void FrameCapture::flush()
+{
+    for (auto& slot : slots)
+    {
+        if (Copying == slot->state)
+        {
+            slot->fence->wait();
+            retire(slot.get());
+        }
+    }
+    // Single worker runs tasks in order
+    worker->submit([]() {}).wait();
+}
+
+void FrameCapture::setStream(std::shared_ptr<FrameStream> stream)
+{
+    flush();
+    this->stream = std::move(stream);
+}
+
+FrameCapture::Statistics FrameCapture::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void FrameCapture::retire(Slot *slot)
+{
+    slot->state = Encoding;
+    worker->submit([this, slot]() { encode(slot); });
+}
+
+void FrameCapture::encode(Slot *slot)
+{
+    const auto begin = std::chrono::high_resolution_clock::now();
+    bool written = true;
+    try
+    {
+        CpuImage image;
+        if (!slot->fileName.empty())
+        {
+            image.width = extent.width;
+            image.height = extent.height;
+            image.pixels.resize(size_t(extent.width) * extent.height * 4);
+        }
+        magma::helpers::mapScoped<uint8_t>(slot->buffer, [this, slot, &image](uint8_t *data)
+        {   // Fence doesn't make device writes visible to host if memory isn't coherent, no-op otherwise
+            const VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr,
+                *slot->buffer->getMemory(), 0, VK_WHOLE_SIZE};
+            vkInvalidateMappedMemoryRanges(*device, 1, &range);
+            if (slot->record)
+                stream->write(data, bgra); // Counts dropped frames by itself
+            if (!image.pixels.empty())
+                memcpy(image.pixels.data(), data, image.pixels.size());
+        });
+        if (!slot->fileName.empty())
+        {
+            if (bgra)
+            {
+                for (size_t i = 0; i < image.pixels.size(); i += 4)
+                    std::swap(image.pixels[i], image.pixels[i + 2]);
+            }
+            const std::string& name = slot->fileName;
+            if (name.size() > 4 && 0 == name.compare(name.size() - 4, 4, ".ppm"))
+                savePpm(name, image);
+            else
+                savePng(name, image);
+        }
+    }
+    catch (const std::exception& exc)
+    {
+        debugOutput((std::string(exc.what()) + "\n").c_str());
+        written = false;
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written)
+            ++statistics.capturedCount;
+        else
+            ++statistics.failedCount;
+        statistics.encodeMs += std::chrono::duration<double, std::milli>(end - begin).count();
+        slot->state = Free;
+    }
+    slotFreed.notify_all();
+}
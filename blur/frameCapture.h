@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../magma/magma.h"
+#include "threadPool.h"
+#include "frameStream.h"
+
+class MemoryTracker;
+
+// Copies framebuffer images into ring of host-visible buffers without waiting
+// for GPU. Slot is retired once fence of its copy is signaled, usually some
+// frames later, then image is converted and written to file by worker thread.
+// If all slots are busy, frame is dropped rather than stalling render loop,
+// unless it goes to blocking stream.
+class FrameCapture
+{
+public:
+    struct Statistics
+    {
+        uint64_t capturedCount = 0; // Written to file or stream
+        uint64_t droppedCount = 0; // No free slot
+        uint64_t failedCount = 0; // Couldn't write file
+        double recordMs = 0.; // Render thread time of all captures
+        double encodeMs = 0.; // Worker thread time of all captures
+        double stallMs = 0.; // Render thread waited for slot (blocking stream)
+    };
+
+    explicit FrameCapture(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::CommandPool> commandPool,
+        const VkExtent2D& extent, bool bgra,
+        uint32_t slotCount = 3,
+        std::shared_ptr<MemoryTracker> memoryTracker = nullptr);
+    // Writes pending captures
+    ~FrameCapture();
+    // Copy is submitted after commands of the frame, present should wait for signal semaphore.
+    // File is PPM if name ends with .ppm, PNG otherwise, empty name means no file. Frame is
+    // also appended to stream if requested. Returns false if frame is dropped.
+    bool capture(std::shared_ptr<magma::Queue> queue,
+        std::shared_ptr<magma::Image> image, VkImageLayout layout,
+        std::shared_ptr<magma::Semaphore> waitSemaphore,
+        std::shared_ptr<magma::Semaphore> signalSemaphore,
+        const std::string& fileName, bool record = false);
+    // Pending captures are written before stream is changed.
+    // Blocking stream makes render thread wait for slot instead of dropping frame.
+    void setStream(std::shared_ptr<FrameStream> stream);
+    // Hands finished copies to worker, never waits
+    void poll();
+    // Waits until all submitted captures are written
+    void flush();
+    Statistics getStatistics() const;
+
+private:
+    enum State : uint32_t
+    {
+        Free,
+        Copying,
+        Encoding
+    };
+
+    struct Slot
+    {
+        std::shared_ptr<magma::DstTransferBuffer> buffer;
+        std::shared_ptr<magma::Fence> fence;
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer;
+        std::string fileName;
+        bool record;
+        std::atomic<uint32_t> state;
+    };
+
+    void retire(Slot *slot);
+    void encode(Slot *slot);
+
+    std::shared_ptr<magma::Device> device;
+    std::shared_ptr<magma::CommandPool> commandPool;
+    const VkExtent2D extent;
+    const bool bgra;
+    std::vector<std::unique_ptr<Slot>> slots;
+    uint32_t next; // Oldest slot, copies are retired in order
+    std::shared_ptr<FrameStream> stream;
+    mutable std::mutex mutex;
+    std::condition_variable slotFreed;
+    Statistics statistics;
+    std::unique_ptr<ThreadPool> worker; // Joined first, while slots are still alive
+};
@@ -0,0 +1,246 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "frameStream.h"
+#include "platform.h"
+
+FrameStream::FrameStream(const std::string& fileName, uint32_t width, uint32_t height,
+    bool blocking, uint32_t frameRate /* 60 */):
+    width(width),
+    height(height),
+    y4m(fileName.size() > 4 && 0 == fileName.compare(fileName.size() - 4, 4, ".y4m")),
+    blocking(blocking),
+    unbuffered(true),
+    chunks(nullptr),
+    chunkCount(0),
+    fileSize(0),
+    fillIndex(0),
+    fillSize(0),
+    writeIndex(0),
+    queuedCount(0),
+    stop(false),
+    failed(false)
+{
+#ifdef _WIN32
+    file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (INVALID_HANDLE_VALUE == file)
+    {
+        unbuffered = false;
+        file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    }
+    if (INVALID_HANDLE_VALUE == file)
+        throw std::runtime_error("failed to create file \"" + fileName + "\"");
+#else
+#ifdef O_DIRECT
+    fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (fd < 0)
+#endif
+    {   // File system may not support direct I/O (e.g. tmpfs)
+        unbuffered = false;
+        fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0)
+        throw std::runtime_error("failed to create file \"" + fileName + "\"");
+#endif
+    // Room for two frames besides the chunk being filled
+    const size_t frameSize = y4m ? (6 + size_t(width) * height * 3) : size_t(width) * height * 4;
+    chunkCount = static_cast<uint32_t>((frameSize + chunkSize - 1)/chunkSize * 2 + 1);
+    storage.resize(chunkCount * chunkSize + alignment);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    chunks = storage.data() + (alignment - address % alignment) % alignment;
+    planes.resize(size_t(width) * height * (y4m ? 3 : 4));
+    if (y4m)
+    {
+        const std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+            " F" + std::to_string(frameRate) + ":1 Ip A1:1 C444\n";
+        put(reinterpret_cast<const uint8_t *>(header.data()), header.size());
+    }
+    writer = std::thread(&FrameStream::run, this);
+}
+
+FrameStream::~FrameStream()
+{
+    close();
+}
+
+bool FrameStream::write(const uint8_t *pixels, bool bgra)
+{
+    static const char frameHeader[] = "FRAME\n";
+    const size_t pixelCount = size_t(width) * height;
+    const size_t frameSize = y4m ? (sizeof(frameHeader) - 1 + pixelCount * 3) : pixelCount * 4;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto hasRoom = [this, frameSize]()
+        {
+            const size_t freeChunks = chunkCount - 1 - queuedCount;
+            return failed || freeChunks * chunkSize + (chunkSize - fillSize) >= frameSize;
+        };
+        if (!hasRoom() && blocking)
+        {   // Backpressure: producer runs at disk speed
+            const auto begin = std::chrono::high_resolution_clock::now();
+            chunkWritten.wait(lock, hasRoom);
+            const auto end = std::chrono::high_resolution_clock::now();
+            statistics.stallMs += std::chrono::duration<double, std::milli>(end - begin).count();
+        }
+        if (failed || !hasRoom())
+        {
+            ++statistics.droppedFrames;
+            return false;
+        }
+    }
+    // Chunks beyond the queued ones belong to producer, fill them without lock
+    const int r = bgra ? 2 : 0, b = bgra ? 0 : 2;
+    if (y4m)
+    {   // BT.601 studio range, planar Y, Cb, Cr
+        uint8_t *yPlane = planes.data();
+        uint8_t *uPlane = yPlane + pixelCount;
+        uint8_t *vPlane = uPlane + pixelCount;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            const int red = pixels[i * 4 + r], green = pixels[i * 4 + 1], blue = pixels[i * 4 + b];
+            yPlane[i] = static_cast<uint8_t>(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+            uPlane[i] = static_cast<uint8_t>(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+            vPlane[i] = static_cast<uint8_t>(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+        }
+        put(reinterpret_cast<const uint8_t *>(frameHeader), sizeof(frameHeader) - 1);
+        put(planes.data(), pixelCount * 3);
+    }
+    else if (bgra)
+    {
+        for (size_t i = 0; i < pixelCount * 4; i += 4)
+        {
+            planes[i] = pixels[i + 2];
+            planes[i + 1] = pixels[i + 1];
+            planes[i + 2] = pixels[i];
+            planes[i + 3] = pixels[i + 3];
+        }
+        put(planes.data(), pixelCount * 4);
+    }
+    else
+        put(pixels, pixelCount * 4);
+    std::lock_guard<std::mutex> lock(mutex);
+    ++statistics.writtenFrames;
+    return true;
+}
+
+void FrameStream::close()
+{
+    if (!writer.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    chunkQueued.notify_one();
+    writer.join();
+    if (fillSize && !failed)
+    {   // Unbuffered write must be whole sectors, file is truncated afterwards
+        const size_t size = unbuffered ? (fillSize + alignment - 1)/alignment * alignment : fillSize;
+        uint8_t *chunk = getChunk(fillIndex);
+        memset(chunk + fillSize, 0, size - fillSize);
+        if (writeFile(chunk, size))
+            statistics.bytesWritten += fillSize;
+        else
+            failed = true;
+    }
+#ifdef _WIN32
+    if (unbuffered)
+    {
+        FILE_END_OF_FILE_INFO endOfFile;
+        endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(fileSize);
+        SetFileInformationByHandle(file, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile));
+    }
+    CloseHandle(file);
+#else
+    if (unbuffered && ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+        failed = true;
+    ::close(fd);
+#endif
+    if (failed)
+        debugOutput("Failed to write frame stream\n");
+}
+
+FrameStream::Statistics FrameStream::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void FrameStream::put(const uint8_t *data, size_t size)
+{
+    fileSize += size;
+    while (size)
+    {
+        const size_t count = std::min(size, chunkSize - fillSize);
+        memcpy(getChunk(fillIndex) + fillSize, data, count);
+        fillSize += count;
+        data += count;
+        size -= count;
+        if (chunkSize == fillSize)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++queuedCount;
+            }
+            chunkQueued.notify_one();
+            fillIndex = (fillIndex + 1) % chunkCount;
+            fillSize = 0;
+        }
+    }
+}
+
+bool FrameStream::writeFile(const uint8_t *data, size_t size)
+{
+    while (size)
+    {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) || !written)
+            return false;
+#else
+        const ssize_t written = ::write(fd, data, size);
+        if (written <= 0)
+            return false;
+#endif
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void FrameStream::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        chunkQueued.wait(lock, [this]() { return queuedCount || stop; });
+        if (!queuedCount)
+            break;
+        const uint8_t *chunk = getChunk(writeIndex);
+        const bool skip = failed; // Keep draining so producer never waits forever
+        lock.unlock();
+        const auto begin = std::chrono::high_resolution_clock::now();
+        const bool written = skip || writeFile(chunk, chunkSize);
+        const auto end = std::chrono::high_resolution_clock::now();
+        lock.lock();
+        if (!written)
+            failed = true;
+        else if (!skip)
+        {
+            statistics.bytesWritten += chunkSize;
+            statistics.writeMs += std::chrono::duration<double, std::milli>(end - begin).count();
+        }
+        writeIndex = (writeIndex + 1) % chunkCount;
+        --queuedCount;
+        chunkWritten.notify_one();
+    }
+}
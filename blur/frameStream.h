@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sequence of frames written into single file by background thread: Y4M (4:4:4)
+// if name ends with .y4m, raw RGBA otherwise. Frames are packed into fixed ring
+// of large aligned chunks, each full chunk is written with one call, bypassing
+// page cache where supported (O_DIRECT, FILE_FLAG_NO_BUFFERING). If disk can't
+// keep up, frame is either dropped or producer waits for free chunk.
+class FrameStream
+{
+public:
+    struct Statistics
+    {
+        uint64_t writtenFrames = 0; // Queued for disk
+        uint64_t droppedFrames = 0; // No room in chunk ring
+        uint64_t bytesWritten = 0;
+        double writeMs = 0.; // Writer thread time in write calls
+        double stallMs = 0.; // Producer time waiting for free chunk
+    };
+
+    explicit FrameStream(const std::string& fileName, uint32_t width, uint32_t height,
+        bool blocking, uint32_t frameRate = 60);
+    ~FrameStream();
+    FrameStream(const FrameStream&) = delete;
+    FrameStream& operator=(const FrameStream&) = delete;
+    // Pixels are tightly packed RGBA or BGRA, single producer thread only.
+    // Returns false if frame is dropped.
+    bool write(const uint8_t *pixels, bool bgra);
+    // Writes the rest of data and closes file
+    void close();
+    bool isBlocking() const { return blocking; }
+    bool isUnbuffered() const { return unbuffered; }
+    Statistics getStatistics() const;
+
+private:
+    uint8_t *getChunk(uint32_t index) { return chunks + size_t(index) * chunkSize; }
+    void put(const uint8_t *data, size_t size);
+    bool writeFile(const uint8_t *data, size_t size);
+    void run();
+
+    static constexpr size_t chunkSize = 4 * 1024 * 1024;
+    static constexpr size_t alignment = 4096; // Sector and page size
+
+#ifdef _WIN32
+    void *file;
+#else
+    int fd;
+#endif
+    const uint32_t width;
+    const uint32_t height;
+    const bool y4m;
+    const bool blocking;
+    bool unbuffered;
+    std::vector<uint8_t> storage;
+    uint8_t *chunks;
+    uint32_t chunkCount;
+    std::vector<uint8_t> planes; // Converted frame
+    uint64_t fileSize;
+    // Producer side
+    uint32_t fillIndex;
+    size_t fillSize;
+    // Shared with writer
+    mutable std::mutex mutex;
+    std::condition_variable chunkQueued;
+    std::condition_variable chunkWritten;
+    uint32_t writeIndex;
+    uint32_t queuedCount;
+    bool stop;
+    bool failed;
+    Statistics statistics;
+    std::thread writer;
+};
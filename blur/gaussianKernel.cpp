@@ -0,0 +1,42 @@
+#include <cmath>
+#include "gaussianKernel.h"
+
+std::vector<float> gaussianWeights(uint32_t radius, float sigma)
+{
+    const int r = static_cast<int>(radius);
+    std::vector<float> weights(2 * radius + 1);
+    float sum = 0.f;
+    for (int x = -r; x <= r; ++x)
+    {
+        const float d = (x * x)/(2.f * sigma * sigma);
+        weights[x + r] = std::exp(-d);
+        sum += weights[x + r];
+    }
+    for (auto& weight : weights)
+        weight /= sum;
+    return weights;
+}
+
+std::vector<LinearTap> linearTaps(uint32_t radius, float sigma)
+{
+    const std::vector<float> weights = gaussianWeights(radius, sigma);
+    const float *w = &weights[radius]; // Center
+    std::vector<LinearTap> positive;
+    for (uint32_t i = 1; i <= radius; i += 2)
+    {
+        if (i + 1 <= radius)
+        {   // Sample between two texels so that filtering weights them proportionally
+            const float weight = w[i] + w[i + 1];
+            const float offset = (i * w[i] + (i + 1) * w[i + 1]) / weight;
+            positive.push_back({offset, weight});
+        }
+        else
+            positive.push_back({static_cast<float>(i), w[i]});
+    }
+    std::vector<LinearTap> taps;
+    for (auto it = positive.rbegin(); it != positive.rend(); ++it)
+        taps.push_back({-it->offset, it->weight});
+    taps.push_back({0.f, w[0]});
+    taps.insert(taps.end(), positive.begin(), positive.end());
+    return taps;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct LinearTap
+{
+    float offset; // In texels
+    float weight;
+};
+
+// Default sigma of blur kernels
+constexpr float defaultSigma = 4.f;
+
+// Normalized weights of taps in range [-radius, radius]
+std::vector<float> gaussianWeights(uint32_t radius, float sigma);
+// Merges pairs of adjacent taps into single bilinear fetches,
+// so that 2*radius + 1 taps are sampled by radius + 1 fetches
+std::vector<LinearTap> linearTaps(uint32_t radius, float sigma);
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <xmmintrin.h>
+#include "hostAllocator.h"
+
+struct HostAllocator::Header
+{
+    uint64_t size; // Requested
+    uint32_t offset; // From beginning of system block
+    uint8_t scope;
+    uint8_t blockClass;
+    uint16_t reserved;
+};
+
+namespace
+{
+std::atomic<uint64_t> heapAllocationCount(0);
+
+const char *scopeNames[HostAllocator::scopeCount] = {
+    "command", "object", "cache", "device", "instance"
+};
+} // namespace
+
+HostAllocator::HostAllocator():
+    chunks(nullptr),
+    freeBlocks(),
+    systemAllocationCount(0)
+{
+    static_assert(sizeof(Header) <= headerSize, "header doesn't fit");
+    callbacks.pUserData = this;
+    callbacks.pfnAllocation = allocationFunction;
+    callbacks.pfnReallocation = reallocationFunction;
+    callbacks.pfnFree = freeFunction;
+    callbacks.pfnInternalAllocation = internalAllocationNotification;
+    callbacks.pfnInternalFree = internalFreeNotification;
+}
+
+HostAllocator::~HostAllocator()
+{
+    while (chunks)
+    {
+        void *next = *reinterpret_cast<void **>(chunks);
+        _mm_free(chunks);
+        chunks = next;
+    }
+}
+
+void *HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (!size)
+        return nullptr;
+    const uint32_t index = blockClass(size, alignment);
+    uint8_t *memory;
+    uint32_t offset;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index < blockClassCount)
+    {
+        FreeBlock *block = freeBlocks[index];
+        if (!block)
+            block = allocateChunk(index);
+        if (!block)
+            return nullptr;
+        freeBlocks[index] = block->next;
+        memory = reinterpret_cast<uint8_t *>(block);
+        offset = static_cast<uint32_t>(headerSize);
+    }
+    else
+    {   // Header is placed right before aligned pointer
+        offset = static_cast<uint32_t>(alignment > headerSize ? alignment : headerSize);
+        memory = static_cast<uint8_t *>(_mm_malloc(size + offset, offset));
+        if (!memory)
+            return nullptr;
+        ++systemAllocationCount;
+    }
+    uint8_t *data = memory + offset;
+    Header *header = reinterpret_cast<Header *>(data - headerSize);
+    header->size = size;
+    header->offset = offset;
+    header->scope = static_cast<uint8_t>(scope);
+    header->blockClass = (index < blockClassCount) ? static_cast<uint8_t>(index) : systemBlock;
+    track(scope, size);
+    return data;
+}
+
+void *HostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (!original)
+        return allocate(size, alignment, scope);
+    if (!size)
+    {
+        free(original);
+        return nullptr;
+    }
+    Header *header = reinterpret_cast<Header *>(static_cast<uint8_t *>(original) - headerSize);
+    if (size <= capacity(header) && (reinterpret_cast<uintptr_t>(original) & (alignment - 1)) == 0)
+    {   // Fits in place
+        std::lock_guard<std::mutex> lock(mutex);
+        Statistics& stats = statistics[header->scope];
+        stats.liveBytes += size - header->size;
+        stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+        header->size = size;
+        return original;
+    }
+    void *data = allocate(size, alignment, scope);
+    if (data)
+    {   // Original is left intact on failure
+        memcpy(data, original, std::min(size, static_cast<size_t>(header->size)));
+        free(original);
+    }
+    return data;
+}
+
+void HostAllocator::free(void *memory) noexcept
+{
+    if (!memory)
+        return;
+    uint8_t *data = static_cast<uint8_t *>(memory);
+    const Header *header = reinterpret_cast<const Header *>(data - headerSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    untrack(static_cast<VkSystemAllocationScope>(header->scope), static_cast<size_t>(header->size));
+    if (header->blockClass != systemBlock)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(data - header->offset);
+        block->next = freeBlocks[header->blockClass];
+        freeBlocks[header->blockClass] = block;
+    }
+    else
+        _mm_free(data - header->offset);
+}
+
+void HostAllocator::internalAllocation(size_t size, VkSystemAllocationScope scope) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics[scope].internalBytes += size;
+}
+
+void HostAllocator::internalFree(size_t size, VkSystemAllocationScope scope) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics[scope].internalBytes -= size;
+}
+
+HostAllocator::Statistics HostAllocator::getStatistics(VkSystemAllocationScope scope) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics[scope];
+}
+
+uint64_t HostAllocator::getSystemAllocationCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return systemAllocationCount;
+}
+
+void HostAllocator::printStatistics(std::ostream& os) const
+{
+    for (uint32_t scope = 0; scope < scopeCount; ++scope)
+    {
+        const Statistics stats = getStatistics(static_cast<VkSystemAllocationScope>(scope));
+        os << scopeNames[scope] << ": " << stats.allocationCount << " allocations, "
+            << stats.liveCount << " live (" << stats.liveBytes << " bytes), peak "
+            << stats.peakBytes << " bytes, internal " << stats.internalBytes << " bytes" << std::endl;
+    }
+    os << getSystemAllocationCount() << " requests to system heap" << std::endl;
+}
+
+uint32_t HostAllocator::blockClass(size_t size, size_t alignment)
+{   // Blocks are 16-byte aligned inside of chunk
+    if (alignment > headerSize)
+        return blockClassCount;
+    uint32_t index = 0;
+    for (size_t blockSize = minBlockSize; blockSize < size + headerSize; blockSize <<= 1)
+        ++index;
+    return index;
+}
+
+size_t HostAllocator::capacity(const Header *header)
+{
+    if (header->blockClass != systemBlock)
+        return (minBlockSize << header->blockClass) - headerSize;
+    return static_cast<size_t>(header->size);
+}
+
+HostAllocator::FreeBlock *HostAllocator::allocateChunk(uint32_t blockClass)
+{
+    uint8_t *chunk = static_cast<uint8_t *>(_mm_malloc(chunkSize, chunkHeaderSize));
+    if (!chunk)
+        return nullptr;
+    ++systemAllocationCount;
+    *reinterpret_cast<void **>(chunk) = chunks;
+    chunks = chunk;
+    // Thread all blocks of chunk into free list
+    const size_t blockSize = minBlockSize << blockClass;
+    FreeBlock *head = nullptr;
+    for (size_t offset = chunkSize - blockSize; offset >= chunkHeaderSize; offset -= blockSize)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + offset);
+        block->next = head;
+        head = block;
+    }
+    freeBlocks[blockClass] = head;
+    return head;
+}
+
+void HostAllocator::track(VkSystemAllocationScope scope, size_t size)
+{
+    Statistics& stats = statistics[scope];
+    ++stats.allocationCount;
+    ++stats.liveCount;
+    stats.liveBytes += size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+}
+
+void HostAllocator::untrack(VkSystemAllocationScope scope, size_t size)
+{
+    Statistics& stats = statistics[scope];
+    --stats.liveCount;
+    stats.liveBytes -= size;
+}
+
+void *VKAPI_CALL HostAllocator::allocationFunction(void *userData,
+    size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator *>(userData)->allocate(size, alignment, scope);
+}
+
+void *VKAPI_CALL HostAllocator::reallocationFunction(void *userData,
+    void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator *>(userData)->reallocate(original, size, alignment, scope);
+}
+
+void VKAPI_CALL HostAllocator::freeFunction(void *userData, void *memory)
+{
+    static_cast<HostAllocator *>(userData)->free(memory);
+}
+
+void VKAPI_CALL HostAllocator::internalAllocationNotification(void *userData,
+    size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator *>(userData)->internalAllocation(size, scope);
+}
+
+void VKAPI_CALL HostAllocator::internalFreeNotification(void *userData,
+    size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator *>(userData)->internalFree(size, scope);
+}
+
+uint64_t getHeapAllocationCount()
+{
+    return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
+// Replacements of global allocation functions only count calls,
+// memory comes from malloc as usual
+void *operator new(std::size_t size)
+{
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept
+{
+    ::free(ptr);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vulkan/vulkan.h>
+
+// Host memory for Vulkan objects, plugged in through VkAllocationCallbacks.
+// Small blocks are carved from 64 KiB chunks into per-size free lists and
+// recycled on free, so allocations made every frame (command scope) stop
+// reaching the system heap once lists are warm. Larger or over-aligned
+// blocks go to the system heap. Chunks are released only on destruction.
+// Counts and bytes are tracked per allocation scope.
+class HostAllocator
+{
+public:
+    struct Statistics
+    {
+        uint64_t allocationCount = 0; // Since creation
+        uint64_t liveCount = 0;
+        uint64_t liveBytes = 0;
+        uint64_t peakBytes = 0;
+        uint64_t internalBytes = 0; // Reported by driver, not allocated through us
+    };
+
+    static constexpr uint32_t scopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    HostAllocator();
+    ~HostAllocator();
+    HostAllocator(const HostAllocator&) = delete;
+    HostAllocator& operator=(const HostAllocator&) = delete;
+    void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void *reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void free(void *memory) noexcept;
+    void internalAllocation(size_t size, VkSystemAllocationScope scope) noexcept;
+    void internalFree(size_t size, VkSystemAllocationScope scope) noexcept;
+    const VkAllocationCallbacks *getCallbacks() const { return &callbacks; }
+    Statistics getStatistics(VkSystemAllocationScope scope) const;
+    // Chunks and large blocks requested from system heap
+    uint64_t getSystemAllocationCount() const;
+    void printStatistics(std::ostream& os) const;
+
+private:
+    struct Header;
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static constexpr size_t headerSize = 16;
+    static constexpr size_t minBlockSize = 32;
+    static constexpr uint32_t blockClassCount = 6; // 32 to 1024 bytes including header
+    static constexpr size_t chunkSize = 64 * 1024;
+    static constexpr size_t chunkHeaderSize = 64;
+    static constexpr uint8_t systemBlock = 0xFF;
+
+    static uint32_t blockClass(size_t size, size_t alignment);
+    static size_t capacity(const Header *header);
+    FreeBlock *allocateChunk(uint32_t blockClass);
+    void track(VkSystemAllocationScope scope, size_t size);
+    void untrack(VkSystemAllocationScope scope, size_t size);
+
+    static VKAPI_ATTR void *VKAPI_CALL allocationFunction(void *userData,
+        size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void *VKAPI_CALL reallocationFunction(void *userData,
+        void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL freeFunction(void *userData, void *memory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocationNotification(void *userData,
+        size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL internalFreeNotification(void *userData,
+        size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    VkAllocationCallbacks callbacks;
+    mutable std::mutex mutex; // Callbacks are invoked from any thread
+    void *chunks; // Linked through first pointer of each chunk
+    FreeBlock *freeBlocks[blockClassCount];
+    Statistics statistics[scopeCount];
+    uint64_t systemAllocationCount;
+};
+
+// Number of calls to global operator new since start of the process.
+// Difference between two calls tells whether code in between touched heap.
+uint64_t getHeapAllocationCount();
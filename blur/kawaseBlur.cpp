@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <string>
+#include "kawaseBlur.h"
+#include "memoryTracker.h"
+
+KawaseBlur::KawaseBlur(std::shared_ptr<magma::ImageView> imageView,
+    const VkExtent2D& extent,
+    std::shared_ptr<magma::Sampler> sampler,
+    std::shared_ptr<magma::RenderPass> renderPass,
+    const magma::PipelineShaderStage& vertexShader,
+    const magma::PipelineShaderStage& downsampleShader,
+    const magma::PipelineShaderStage& upsampleShader,
+    std::shared_ptr<magma::PipelineCache> pipelineCache):
+    levels(maxLevels),
+    offset(0.f)
+{
+    std::shared_ptr<magma::Device> device = imageView->getDevice();
+    const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    const magma::AttachmentDescription colorAttachment(format, 1, magma::attachments::colorDontCareStoreShaderReadOnly);
+    levelRenderPass = std::shared_ptr<magma::RenderPass>(new magma::RenderPass(
+        device, {colorAttachment}));
+    uniformPyramid = std::make_shared<magma::UniformBuffer<Pyramid>>(device);
+
+    constexpr magma::Descriptor oneUniformBuffer = magma::descriptors::UniformBuffer(1);
+    constexpr magma::Descriptor oneImageSampler = magma::descriptors::CombinedImageSampler(1);
+    constexpr uint32_t maxDescriptorSets = maxLevels * 2;
+    descriptorPool = std::shared_ptr<magma::DescriptorPool>(new magma::DescriptorPool(device, maxDescriptorSets,
+        {
+            magma::descriptors::UniformBuffer(maxDescriptorSets),
+            magma::descriptors::CombinedImageSampler(maxDescriptorSets)
+        }));
+    descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        std::initializer_list<magma::DescriptorSetLayout::Binding>{
+            magma::bindings::FragmentStageBinding(0, oneImageSampler),
+            magma::bindings::FragmentStageBinding(1, oneUniformBuffer)
+        });
+    pipelineLayout = std::make_shared<magma::PipelineLayout>(descriptorSetLayout);
+
+    VkExtent2D levelExtent = extent;
+    std::shared_ptr<magma::ImageView> upperView = imageView;
+    for (Level& level : pyramid)
+    {   // Each level has half resolution of the upper one
+        levelExtent.width = std::max(levelExtent.width >> 1, 1U);
+        levelExtent.height = std::max(levelExtent.height >> 1, 1U);
+        level.extent = levelExtent;
+        level.color = std::make_shared<magma::ColorAttachment2D>(device, format, levelExtent, 1, 1);
+        level.colorView = std::make_shared<magma::ImageView>(level.color);
+        level.framebuffer = std::shared_ptr<magma::Framebuffer>(new magma::Framebuffer(
+            levelRenderPass, {level.colorView}));
+        level.downsampleDescriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+        level.downsampleDescriptorSet->update(0, upperView, sampler);
+        level.downsampleDescriptorSet->update(1, uniformPyramid);
+        level.upsampleDescriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+        level.upsampleDescriptorSet->update(0, level.colorView, sampler);
+        level.upsampleDescriptorSet->update(1, uniformPyramid);
+        upperView = level.colorView;
+    }
+
+    downsamplePipeline = createPipeline(levelRenderPass, {vertexShader, downsampleShader}, pipelineCache);
+    upsamplePipeline = createPipeline(levelRenderPass, {vertexShader, upsampleShader}, pipelineCache);
+    composePipeline = createPipeline(renderPass, {vertexShader, upsampleShader}, pipelineCache);
+    setOffset(1.f);
+}
+
+void KawaseBlur::setLevels(uint32_t levels)
+{
+    this->levels = std::min(std::max(levels, 1U), maxLevels);
+}
+
+void KawaseBlur::setOffset(float offset)
+{
+    this->offset = offset;
+    magma::helpers::mapScoped<Pyramid>(uniformPyramid, true, [offset](auto *pyramid)
+    {
+        pyramid->offset = offset;
+    });
+}
+
+void KawaseBlur::downsample(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad, uint32_t level) const
+{
+    drawLevel(cmdBuffer, quad, pyramid[level], downsamplePipeline, pyramid[level].downsampleDescriptorSet);
+}
+
+void KawaseBlur::upsample(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad, uint32_t level) const
+{
+    drawLevel(cmdBuffer, quad, pyramid[level - 1], upsamplePipeline, pyramid[level].upsampleDescriptorSet);
+}
+
+void KawaseBlur::compose(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad) const
+{
+    cmdBuffer->bindVertexBuffer(0, quad);
+    cmdBuffer->bindDescriptorSet(composePipeline, pyramid[0].upsampleDescriptorSet);
+    cmdBuffer->bindPipeline(composePipeline);
+    cmdBuffer->draw(4);
+}
+
+void KawaseBlur::trackMemory(MemoryTracker& tracker) const
+{
+    for (uint32_t i = 0; i < maxLevels; ++i)
+        tracker.add("kawaseBlur.level" + std::to_string(i), MemoryTag::Attachment, pyramid[i].color);
+    tracker.add("kawaseBlur.uniformPyramid", MemoryTag::Uniform, uniformPyramid,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void KawaseBlur::drawLevel(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad,
+    const Level& level,
+    std::shared_ptr<magma::GraphicsPipeline> pipeline,
+    std::shared_ptr<magma::DescriptorSet> descriptorSet) const
+{
+    cmdBuffer->beginRenderPass(levelRenderPass, level.framebuffer, {/* don't clear */});
+    {
+        cmdBuffer->setViewport(0, 0, level.extent.width, level.extent.height);
+        cmdBuffer->setScissor(0, 0, level.extent.width, level.extent.height);
+        cmdBuffer->bindVertexBuffer(0, quad);
+        cmdBuffer->bindDescriptorSet(pipeline, descriptorSet);
+        cmdBuffer->bindPipeline(pipeline);
+        cmdBuffer->draw(4);
+    }
+    cmdBuffer->endRenderPass();
+}
+
+std::shared_ptr<magma::GraphicsPipeline> KawaseBlur::createPipeline(std::shared_ptr<magma::RenderPass> renderPass,
+    const std::vector<magma::PipelineShaderStage>& shaderStages,
+    std::shared_ptr<magma::PipelineCache> pipelineCache) const
+{
+    return std::make_shared<magma::GraphicsPipeline>(renderPass->getDevice(),
+        shaderStages,
+        magma::renderstates::pos2f,
+        magma::renderstates::triangleStrip,
+        magma::renderstates::fillCullNoneCW,
+        magma::renderstates::dontMultisample,
+        magma::renderstates::depthAlwaysDontWrite,
+        magma::renderstates::dontBlendRgb,
+        std::initializer_list<VkDynamicState>{
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        },
+        pipelineLayout,
+        renderPass, 0,
+        pipelineCache,
+        nullptr, nullptr, 0);
+}
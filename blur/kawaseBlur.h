@@ -0,0 +1,77 @@
+#pragma once
+#include "../magma/magma.h"
+
+class MemoryTracker;
+
+// Dual Kawase blur: source is downsampled through chain of half resolution
+// levels and upsampled back, last upsample draws to the target render pass.
+// Each pass has fixed number of taps, so perceived radius grows exponentially
+// with number of levels while cost stays nearly constant.
+class KawaseBlur
+{
+public:
+    static constexpr uint32_t maxLevels = 6;
+
+    explicit KawaseBlur(std::shared_ptr<magma::ImageView> imageView,
+        const VkExtent2D& extent,
+        std::shared_ptr<magma::Sampler> sampler,
+        std::shared_ptr<magma::RenderPass> renderPass,
+        const magma::PipelineShaderStage& vertexShader,
+        const magma::PipelineShaderStage& downsampleShader,
+        const magma::PipelineShaderStage& upsampleShader,
+        std::shared_ptr<magma::PipelineCache> pipelineCache);
+    // Command buffers should be re-recorded after change of level count
+    void setLevels(uint32_t levels);
+    uint32_t getLevels() const { return levels; }
+    void setOffset(float offset);
+    float getOffset() const { return offset; }
+    // Level is drawn from the upper one (source image for level 0) in its own render pass
+    void downsample(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad, uint32_t level) const;
+    // Level above is drawn from this one, for levels from getLevels() - 1 down to 1
+    void upsample(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad, uint32_t level) const;
+    // Last upsample pass inside of target render pass, viewport and scissor are set by caller
+    void compose(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad) const;
+    // Level 0 is read by compose()
+    std::shared_ptr<magma::Image> getLevelImage(uint32_t level) const { return pyramid[level].color; }
+    void trackMemory(MemoryTracker& tracker) const;
+
+private:
+    struct alignas(16) Pyramid
+    {
+        float offset;
+    };
+
+    struct Level
+    {
+        VkExtent2D extent;
+        std::shared_ptr<magma::ColorAttachment2D> color;
+        std::shared_ptr<magma::ImageView> colorView;
+        std::shared_ptr<magma::Framebuffer> framebuffer;
+        std::shared_ptr<magma::DescriptorSet> downsampleDescriptorSet; // Reads upper level
+        std::shared_ptr<magma::DescriptorSet> upsampleDescriptorSet; // Reads this level
+    };
+
+    std::shared_ptr<magma::GraphicsPipeline> createPipeline(std::shared_ptr<magma::RenderPass> renderPass,
+        const std::vector<magma::PipelineShaderStage>& shaderStages,
+        std::shared_ptr<magma::PipelineCache> pipelineCache) const;
+    void drawLevel(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad,
+        const Level& level,
+        std::shared_ptr<magma::GraphicsPipeline> pipeline,
+        std::shared_ptr<magma::DescriptorSet> descriptorSet) const;
+
+    uint32_t levels;
+    float offset;
+    Level pyramid[maxLevels];
+    std::shared_ptr<magma::RenderPass> levelRenderPass;
+    std::shared_ptr<magma::UniformBuffer<Pyramid>> uniformPyramid;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> descriptorSetLayout;
+    std::shared_ptr<magma::PipelineLayout> pipelineLayout;
+    std::shared_ptr<magma::GraphicsPipeline> downsamplePipeline;
+    std::shared_ptr<magma::GraphicsPipeline> upsamplePipeline;
+    std::shared_ptr<magma::GraphicsPipeline> composePipeline;
+};
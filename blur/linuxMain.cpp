@@ -0,0 +1,275 @@
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "blurApp.h"
+
+std::unique_ptr<VkApp> createVulkanApp(const AppEntry&);
+
+namespace
+{
+std::unique_ptr<VkApp> vkApp;
+bool quit = false;
+
+void onError(const std::string& msg, const char *caption)
+{
+    std::cerr << caption << ": " << msg << std::endl;
+}
+
+std::unique_ptr<VkApp> createAppInstance(const AppEntry& entry)
+{
+    try
+    {
+        return createVulkanApp(entry);
+    }
+    catch (const magma::exception::ErrorResult& exc)
+    {
+        std::ostringstream msg;
+        msg << exc.location().file_name() << "(" << exc.location().line() << "):" << std::endl
+            << std::endl
+            << magma::helpers::stringize(exc.error()) << std::endl
+            << exc.what();
+        onError(msg.str(), "Vulkan");
+    }
+    catch (const magma::exception::Exception& exc)
+    {
+        std::ostringstream msg;
+        msg << exc.location().file_name() << "(" << exc.location().line() << "):" << std::endl
+            << "Error: " << exc.what();
+        onError(msg.str(), "Magma");
+    }
+    catch (const std::exception& exc)
+    {
+        std::ostringstream msg;
+        msg << "Error: " << exc.what() << std::endl;
+        onError(msg.str(), "Error");
+    }
+    catch (...)
+    {
+        onError("unknown exception", "Unknown");
+    }
+
+    return nullptr;
+}
+
+void writeProfile(const std::string& csvFileName, const std::string& traceFileName)
+{
+    const Profiler *profiler = vkApp->getProfiler();
+    if (!csvFileName.empty())
+    {
+        std::ofstream csv(csvFileName);
+        profiler->writeCsv(csv);
+    }
+    if (!traceFileName.empty())
+    {
+        std::ofstream trace(traceFileName);
+        profiler->writeChromeTrace(trace);
+    }
+}
+
+// Returns number of heap allocations made by steady-state frames
+uint64_t runHeadless(uint32_t frameCount)
+{   // Free lists and caches are filled by first frames
+    constexpr uint32_t warmupFrames = 4;
+    const HostAllocator *hostAllocator = vkApp->getHostAllocator();
+    uint64_t heapAllocations = 0, systemAllocations = 0;
+    const auto begin = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        const uint64_t heapCount = getHeapAllocationCount();
+        const uint64_t systemCount = hostAllocator->getSystemAllocationCount();
+        vkApp->render();
+        if (i >= warmupFrames)
+        {
+            heapAllocations += getHeapAllocationCount() - heapCount;
+            systemAllocations += hostAllocator->getSystemAllocationCount() - systemCount;
+        }
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    const auto mcs = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+    const double seconds = mcs.count() * 1e-6;
+    std::cout << frameCount << " frames in " << seconds << " s ("
+        << (seconds > 0. ? frameCount/seconds : 0.) << " fps)" << std::endl;
+    std::cout << "time to first frame " << vkApp->getStartupTime() << " ms ("
+        << (vkApp->isPipelineCacheWarm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+    std::cout << "Vulkan host memory:" << std::endl;
+    hostAllocator->printStatistics(std::cout);
+    std::cout << heapAllocations << " heap allocations and " << systemAllocations
+        << " Vulkan allocations from system heap in steady-state frames" << std::endl;
+    return heapAllocations + systemAllocations;
+}
+
+void printCaptureStatistics(const FrameCapture::Statistics& statistics)
+{
+    const double count = static_cast<double>(statistics.capturedCount + statistics.failedCount);
+    std::cout << statistics.capturedCount << " frames captured, " << statistics.droppedCount << " dropped, "
+        << statistics.failedCount << " failed" << std::endl;
+    if (count > 0.)
+    {
+        std::cout << "capture overhead " << statistics.recordMs/count << " ms on render thread, "
+            << statistics.encodeMs/count << " ms on worker thread per frame" << std::endl;
+    }
+    if (statistics.stallMs > 0.)
+        std::cout << statistics.stallMs << " ms waited for free readback slot" << std::endl;
+}
+
+void printRecordStatistics(const FrameStream::Statistics& statistics)
+{
+    std::cout << statistics.writtenFrames << " frames recorded, " << statistics.droppedFrames << " dropped, "
+        << statistics.stallMs << " ms waited for disk" << std::endl;
+    if (statistics.writeMs > 0.)
+        std::cout << "disk write " << statistics.bytesWritten/(statistics.writeMs * 1000.) << " MB/s" << std::endl;
+}
+
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+void runWindowed(AppEntry& entry, const std::string& csvFileName, const std::string& traceFileName)
+{
+    xcb_atom_t deleteWindow;
+    try
+    {
+        deleteWindow = createXcbWindow(entry, "Render Programmer Test");
+    }
+    catch (const std::exception& exc)
+    {
+        onError(exc.what(), "XCB");
+        return;
+    }
+    vkApp = createAppInstance(entry);
+    if (vkApp)
+    {
+        while (!quit)
+        {
+            xcb_generic_event_t *event;
+            while ((event = xcb_poll_for_event(entry.connection)))
+            {
+                switch (event->response_type & 0x7f)
+                {
+                case XCB_KEY_PRESS:
+                    {
+                        constexpr xcb_keycode_t escape = 9;
+                        const xcb_key_press_event_t *keyPress = reinterpret_cast<const xcb_key_press_event_t *>(event);
+                        if (escape == keyPress->detail)
+                            quit = true;
+                    }
+                    break;
+                case XCB_CLIENT_MESSAGE:
+                    if (reinterpret_cast<const xcb_client_message_event_t *>(event)->data.data32[0] == deleteWindow)
+                        quit = true;
+                    break;
+                }
+                free(event);
+            }
+            if (!quit)
+                vkApp->render();
+        }
+        writeProfile(csvFileName, traceFileName);
+    }
+
+    vkApp.reset();
+    destroyXcbWindow(entry);
+}
+#endif // VK_USE_PLATFORM_XCB_KHR
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    AppEntry entry;
+    entry.width = 512;
+    entry.height = 512;
+    uint32_t frameCount = 1000;
+    std::string csvFileName, traceFileName;
+    bool validate = false;
+    bool checkAllocations = false;
+    bool memoryReport = false;
+    std::string capturePrefix;
+    std::string recordFileName;
+    bool recordBlocking = false;
+#if !defined(VK_USE_PLATFORM_XCB_KHR)
+    entry.headless = true;
+#endif
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if ("--headless" == arg)
+            entry.headless = true;
+        else if ("--vsync" == arg)
+            entry.vSync = true;
+        else if ("--width" == arg && hasValue)
+            entry.width = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--height" == arg && hasValue)
+            entry.height = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--frames" == arg && hasValue)
+            frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--no-pipeline-cache" == arg)
+            entry.pipelineCacheFileName = nullptr;
+        else if ("--validate" == arg)
+            validate = true;
+        else if ("--check-allocations" == arg)
+            checkAllocations = true;
+        else if ("--memory-report" == arg)
+            memoryReport = true;
+        else if ("--csv" == arg && hasValue)
+            csvFileName = argv[++i];
+        else if ("--trace" == arg && hasValue)
+            traceFileName = argv[++i];
+        else if ("--capture" == arg && hasValue)
+            capturePrefix = argv[++i];
+        else if ("--record" == arg && hasValue)
+            recordFileName = argv[++i];
+        else if ("--record-blocking" == arg)
+            recordBlocking = true;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--headless] [--vsync] [--width W] [--height H] [--frames N]"
+                << " [--csv profile.csv] [--trace trace.json] [--validate] [--check-allocations] [--memory-report] [--no-pipeline-cache]"
+                << " [--capture prefix] [--record frames.y4m|frames.rgba] [--record-blocking]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (entry.headless)
+    {
+        vkApp = createAppInstance(entry);
+        if (!vkApp)
+            return 1;
+        if (!capturePrefix.empty())
+            vkApp->captureAllFrames(capturePrefix);
+        if (!recordFileName.empty())
+            vkApp->recordFrames(recordFileName, recordBlocking);
+        const uint64_t frameAllocations = runHeadless(frameCount);
+        writeProfile(csvFileName, traceFileName);
+        if (!capturePrefix.empty() || !recordFileName.empty())
+            printCaptureStatistics(vkApp->finishCaptures());
+        if (!recordFileName.empty())
+            printRecordStatistics(vkApp->finishRecording());
+        if (memoryReport)
+            vkApp->getMemoryTracker()->writeReport(std::cout);
+        bool passed = true;
+        if (checkAllocations)
+        {
+            passed = !frameAllocations;
+            std::cout << "allocation check " << (passed ? "passed" : "failed") << std::endl;
+        }
+        if (validate)
+        {   // Thresholds allow for rounding of 8-bit intermediate and bilinear taps
+            constexpr double minPsnr = 40.;
+            constexpr uint32_t maxError = 8;
+            const bool valid = validateBlur(vkApp.get(), minPsnr, maxError, std::cout);
+            std::cout << "validation " << (valid ? "passed" : "failed") << std::endl;
+            passed = passed && valid;
+        }
+        vkApp.reset();
+        if (!passed)
+            return 1;
+    }
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+    else
+        runWindowed(entry, csvFileName, traceFileName);
+#endif
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <stdexcept>
+#include <string>
+#include "mappedFile.h"
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char *fileName):
+    file(INVALID_HANDLE_VALUE),
+    mapping(nullptr),
+    data(nullptr),
+    size(0)
+{
+    file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == file)
+        throw std::runtime_error("file \"" + std::string(fileName) + "\" not found");
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size)
+    {   // Zero-length file can't be mapped
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data)
+        {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("failed to map file \"" + std::string(fileName) + "\"");
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const char *fileName):
+    fd(-1),
+    data(nullptr),
+    size(0)
+{
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("file \"" + std::string(fileName) + "\" not found");
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("failed to stat file \"" + std::string(fileName) + "\"");
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size)
+    {   // Zero-length file can't be mapped
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data)
+        {
+            close(fd);
+            throw std::runtime_error("failed to map file \"" + std::string(fileName) + "\"");
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        munmap(data, size);
+    close(fd);
+}
+#endif // _WIN32
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+
+// Read-only view of the whole file, pages are loaded by OS on first access
+class MappedFile
+{
+public:
+    explicit MappedFile(const char *fileName);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    const void *getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+    void *data;
+    size_t size;
+};
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <stdexcept>
+#include "memoryAllocator.h"
+
+MemoryStatistics& MemoryStatistics::operator+=(const MemoryStatistics& other)
+{
+    blockCount += other.blockCount;
+    allocationCount += other.allocationCount;
+    blockBytes += other.blockBytes;
+    usedBytes += other.usedBytes;
+    wastedBytes += other.wastedBytes;
+    freeBytes += other.freeBytes;
+    largestFreeRange = std::max(largestFreeRange, other.largestFreeRange);
+    return *this;
+}
+
+BlockAllocator::BlockAllocator(VkDeviceSize blockSize, std::function<void(uint32_t block, VkDeviceSize size)> allocateBlock):
+    blockSize(blockSize),
+    allocateBlock(std::move(allocateBlock)),
+    freeLists(sizeClass(blockSize) + 1)
+{
+    if (blockSize & (blockSize - 1))
+        throw std::invalid_argument("block size should be power of two");
+}
+
+BlockAllocator::Range BlockAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (!size || (alignment & (alignment - 1)))
+        throw std::invalid_argument("invalid allocation size or alignment");
+    Range range;
+    const uint32_t cls = sizeClass(std::max(size, alignment));
+    const VkDeviceSize classSize = VkDeviceSize(1) << cls;
+    if (classSize > blockSize/2)
+    {   // Doesn't fit into shared block
+        range = Range{newBlock(size), 0, size, size};
+        blocks[range.block].dedicated = true;
+        statistics.freeBytes -= size;
+    }
+    else if (splitFreeRange(cls))
+    {
+        range = freeLists[cls].back();
+        freeLists[cls].pop_back();
+        statistics.freeBytes -= classSize;
+    }
+    else
+    {   // Carve from the first shared block that has room
+        uint32_t block = 0;
+        VkDeviceSize offset = 0;
+        for (; block < blocks.size(); ++block)
+        {
+            const Block& b = blocks[block];
+            offset = (b.top + classSize - 1) & ~(classSize - 1);
+            if (!b.dedicated && offset + classSize <= b.size)
+                break;
+        }
+        if (block == blocks.size())
+        {
+            block = newBlock(blockSize);
+            offset = 0;
+        }
+        Block& b = blocks[block];
+        // Alignment gap is split into naturally aligned ranges of smaller classes
+        while (b.top < offset)
+        {
+            VkDeviceSize piece = b.top & (~b.top + 1); // Largest power of two dividing top
+            while (b.top + piece > offset)
+                piece >>= 1;
+            statistics.freeBytes -= piece;
+            addFreeRange(block, b.top, piece);
+            b.top += piece;
+        }
+        b.top += classSize;
+        statistics.freeBytes -= classSize;
+        range = Range{block, offset, classSize, size};
+    }
+    range.requestedSize = size;
+    ++statistics.allocationCount;
+    statistics.usedBytes += size;
+    statistics.wastedBytes += range.size - size;
+    updateLargestFreeRange();
+    return range;
+}
+
+void BlockAllocator::free(const Range& range)
+{
+    --statistics.allocationCount;
+    statistics.usedBytes -= range.requestedSize;
+    statistics.wastedBytes -= range.size - range.requestedSize;
+    if (blocks[range.block].dedicated)
+    {   // Memory is reused by shared ranges
+        blocks[range.block].dedicated = false;
+        blocks[range.block].top = 0;
+        statistics.freeBytes += range.size;
+    }
+    else
+        addFreeRange(range.block, range.offset, range.size);
+    updateLargestFreeRange();
+}
+
+uint32_t BlockAllocator::sizeClass(VkDeviceSize size)
+{
+    uint32_t cls = minSizeClass;
+    while ((VkDeviceSize(1) << cls) < size)
+        ++cls;
+    return cls;
+}
+
+void BlockAllocator::addFreeRange(uint32_t block, VkDeviceSize offset, VkDeviceSize size)
+{
+    const uint32_t cls = sizeClass(size);
+    if ((VkDeviceSize(1) << cls) != size)
+        return; // Too small piece of alignment gap, lost until block is released
+    freeLists[cls].push_back(Range{block, offset, size, 0});
+    statistics.freeBytes += size;
+}
+
+bool BlockAllocator::splitFreeRange(uint32_t cls)
+{
+    uint32_t larger = cls;
+    while (larger < freeLists.size() && freeLists[larger].empty())
+        ++larger;
+    if (larger == freeLists.size())
+        return false;
+    while (larger > cls)
+    {   // Halves of naturally aligned range are naturally aligned too
+        const Range range = freeLists[larger].back();
+        freeLists[larger].pop_back();
+        const VkDeviceSize half = range.size/2;
+        --larger;
+        freeLists[larger].push_back(Range{range.block, range.offset + half, half, 0});
+        freeLists[larger].push_back(Range{range.block, range.offset, half, 0});
+    }
+    return true;
+}
+
+uint32_t BlockAllocator::newBlock(VkDeviceSize size)
+{
+    const uint32_t block = static_cast<uint32_t>(blocks.size());
+    allocateBlock(block, size);
+    blocks.push_back(Block{size, 0, false});
+    ++statistics.blockCount;
+    statistics.blockBytes += size;
+    statistics.freeBytes += size;
+    return block;
+}
+
+void BlockAllocator::updateLargestFreeRange()
+{
+    VkDeviceSize largest = 0;
+    for (uint32_t cls = 0; cls < freeLists.size(); ++cls)
+    {
+        if (!freeLists[cls].empty())
+            largest = VkDeviceSize(1) << cls;
+    }
+    for (const Block& block : blocks)
+    {
+        if (!block.dedicated)
+            largest = std::max(largest, block.size - block.top);
+    }
+    statistics.largestFreeRange = largest;
+}
+
+VkDeviceSize LinearAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    const VkDeviceSize offset = (top + alignment - 1) / alignment * alignment;
+    if (offset + size > capacity)
+        throw std::length_error("linear allocator is out of memory");
+    top = offset + size;
+    return offset;
+}
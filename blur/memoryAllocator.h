@@ -0,0 +1,83 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct MemoryStatistics
+{
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize blockBytes = 0; // Reserved from driver
+    VkDeviceSize usedBytes = 0; // Requested by allocations
+    VkDeviceSize wastedBytes = 0; // Rounding to size class
+    VkDeviceSize freeBytes = 0; // Free lists and untouched tails of blocks
+    VkDeviceSize largestFreeRange = 0;
+
+    // Zero if all free memory is contiguous
+    float getFragmentation() const
+    {
+        return freeBytes ? 1.f - static_cast<float>(largestFreeRange)/freeBytes : 0.f;
+    }
+    MemoryStatistics& operator+=(const MemoryStatistics& other);
+};
+
+// Sub-allocates ranges of large blocks. Sizes are rounded up to power-of-two
+// classes and each range is aligned to its size, so any power-of-two alignment
+// up to the size is satisfied without padding. Freed ranges go to per-class
+// free lists and are split in halves for smaller requests; requests larger
+// than half of block get dedicated block.
+// Blocks are released only when allocator is destroyed.
+class BlockAllocator
+{
+public:
+    struct Range
+    {
+        uint32_t block;
+        VkDeviceSize offset;
+        VkDeviceSize size; // Size of class, or of dedicated block
+        VkDeviceSize requestedSize;
+    };
+
+    // Callback reserves memory for new block with given index and size
+    BlockAllocator(VkDeviceSize blockSize, std::function<void(uint32_t block, VkDeviceSize size)> allocateBlock);
+    Range allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void free(const Range& range);
+    const MemoryStatistics& getStatistics() const { return statistics; }
+
+private:
+    static constexpr uint32_t minSizeClass = 8; // 256 bytes
+    static uint32_t sizeClass(VkDeviceSize size);
+    void addFreeRange(uint32_t block, VkDeviceSize offset, VkDeviceSize size);
+    // Makes free list of the class non-empty if there is larger free range
+    bool splitFreeRange(uint32_t cls);
+    uint32_t newBlock(VkDeviceSize size);
+    void updateLargestFreeRange();
+
+    struct Block
+    {
+        VkDeviceSize size;
+        VkDeviceSize top; // Memory above is not carved yet
+        bool dedicated;
+    };
+
+    const VkDeviceSize blockSize;
+    std::function<void(uint32_t, VkDeviceSize)> allocateBlock;
+    std::vector<Block> blocks;
+    std::vector<std::vector<Range>> freeLists; // By size class
+    MemoryStatistics statistics;
+};
+
+// Bump allocator for staging data within single range, reset when copies are done
+class LinearAllocator
+{
+public:
+    explicit LinearAllocator(VkDeviceSize capacity): capacity(capacity), top(0) {}
+    // Returns offset, throws if capacity is exceeded
+    VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void reset() { top = 0; }
+    VkDeviceSize getUsedBytes() const { return top; }
+
+private:
+    const VkDeviceSize capacity;
+    VkDeviceSize top;
+};
@@ -0,0 +1,140 @@
+#include <stdexcept>
+#include "memoryPool.h"
+
+DeviceMemoryPool::DeviceMemoryPool(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    VkMemoryPropertyFlags properties,
+    VkDeviceSize blockSize /* 16 * 1024 * 1024 */,
+    const VkAllocationCallbacks *allocator /* nullptr */):
+    device(std::move(device)),
+    properties(properties),
+    blockSize(blockSize),
+    allocator(allocator)
+{
+    vkGetPhysicalDeviceMemoryProperties(*physicalDevice, &memoryProperties);
+    memoryTypes.resize(memoryProperties.memoryTypeCount);
+}
+
+DeviceMemoryPool::~DeviceMemoryPool()
+{
+    for (MemoryType& memoryType : memoryTypes)
+    {
+        for (VkDeviceMemory memory : memoryType.blocks)
+        {   // Unmapped implicitly
+            vkFreeMemory(*device, memory, allocator);
+        }
+    }
+}
+
+DeviceMemoryPool::Allocation DeviceMemoryPool::allocate(const VkMemoryRequirements& requirements)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint32_t index = findMemoryType(requirements.memoryTypeBits);
+    MemoryType& memoryType = memoryTypes[index];
+    if (!memoryType.allocator)
+    {
+        memoryType.allocator = std::make_unique<BlockAllocator>(blockSize,
+            [this, index, &memoryType](uint32_t block, VkDeviceSize size)
+            {
+                VkMemoryAllocateInfo info;
+                info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                info.pNext = nullptr;
+                info.allocationSize = size;
+                info.memoryTypeIndex = index;
+                VkDeviceMemory memory;
+                if (vkAllocateMemory(*device, &info, allocator, &memory) != VK_SUCCESS)
+                    throw std::runtime_error("failed to allocate memory block");
+                void *data = nullptr;
+                if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+                {
+                    if (vkMapMemory(*device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+                    {
+                        vkFreeMemory(*device, memory, allocator);
+                        throw std::runtime_error("failed to map memory block");
+                    }
+                }
+                memoryType.blocks.push_back(memory);
+                memoryType.mappedBlocks.push_back(data);
+            });
+    }
+    Allocation allocation;
+    allocation.range = memoryType.allocator->allocate(requirements.size, requirements.alignment);
+    allocation.memory = memoryType.blocks[allocation.range.block];
+    allocation.offset = allocation.range.offset;
+    allocation.memoryType = index;
+    if (memoryType.mappedBlocks[allocation.range.block])
+        allocation.data = static_cast<uint8_t *>(memoryType.mappedBlocks[allocation.range.block]) + allocation.offset;
+    return allocation;
+}
+
+void DeviceMemoryPool::free(const Allocation& allocation)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryTypes[allocation.memoryType].allocator->free(allocation.range);
+}
+
+MemoryStatistics DeviceMemoryPool::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryStatistics statistics;
+    for (const MemoryType& memoryType : memoryTypes)
+    {
+        if (memoryType.allocator)
+            statistics += memoryType.allocator->getStatistics();
+    }
+    return statistics;
+}
+
+uint32_t DeviceMemoryPool::findMemoryType(uint32_t memoryTypeBits) const
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((memoryTypeBits & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+    throw std::runtime_error("no suitable memory type");
+}
+
+PooledBuffer::PooledBuffer(std::shared_ptr<DeviceMemoryPool> pool,
+    VkDeviceSize size, VkBufferUsageFlags usage):
+    pool(std::move(pool)),
+    buffer(VK_NULL_HANDLE),
+    size(size)
+{
+    std::shared_ptr<magma::Device> device = this->pool->getDevice();
+    VkBufferCreateInfo info;
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.pNext = nullptr;
+    info.flags = 0;
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = nullptr;
+    if (vkCreateBuffer(*device, &info, this->pool->getAllocationCallbacks(), &buffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to create buffer");
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(*device, buffer, &requirements);
+    try
+    {
+        allocation = this->pool->allocate(requirements);
+    }
+    catch (...)
+    {
+        vkDestroyBuffer(*device, buffer, this->pool->getAllocationCallbacks());
+        throw;
+    }
+    if (vkBindBufferMemory(*device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        this->pool->free(allocation);
+        vkDestroyBuffer(*device, buffer, this->pool->getAllocationCallbacks());
+        throw std::runtime_error("failed to bind buffer memory");
+    }
+}
+
+PooledBuffer::~PooledBuffer()
+{
+    vkDestroyBuffer(*pool->getDevice(), buffer, pool->getAllocationCallbacks());
+    pool->free(allocation);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <mutex>
+#include "../magma/magma.h"
+#include "memoryAllocator.h"
+
+// Large VkDeviceMemory blocks shared by many buffers, with one allocator
+// per memory type. Host-visible blocks stay mapped for their lifetime.
+class DeviceMemoryPool
+{
+public:
+    struct Allocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void *data = nullptr; // Mapped pointer of host-visible memory
+        uint32_t memoryType = 0;
+        BlockAllocator::Range range = {};
+    };
+
+    explicit DeviceMemoryPool(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+        VkMemoryPropertyFlags properties,
+        VkDeviceSize blockSize = 16 * 1024 * 1024,
+        const VkAllocationCallbacks *allocator = nullptr);
+    ~DeviceMemoryPool();
+    std::shared_ptr<magma::Device> getDevice() const { return device; }
+    const VkAllocationCallbacks *getAllocationCallbacks() const { return allocator; }
+    Allocation allocate(const VkMemoryRequirements& requirements);
+    void free(const Allocation& allocation);
+    // Summed over memory types
+    MemoryStatistics getStatistics() const;
+
+private:
+    struct MemoryType
+    {
+        std::unique_ptr<BlockAllocator> allocator;
+        std::vector<VkDeviceMemory> blocks;
+        std::vector<void *> mappedBlocks;
+    };
+
+    uint32_t findMemoryType(uint32_t memoryTypeBits) const;
+
+    std::shared_ptr<magma::Device> device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    const VkMemoryPropertyFlags properties;
+    const VkDeviceSize blockSize;
+    const VkAllocationCallbacks *allocator;
+    mutable std::mutex mutex; // Resources are created by concurrent startup tasks
+    std::vector<MemoryType> memoryTypes;
+};
+
+// Buffer bound to sub-allocated range of pool memory
+class PooledBuffer
+{
+public:
+    explicit PooledBuffer(std::shared_ptr<DeviceMemoryPool> pool,
+        VkDeviceSize size, VkBufferUsageFlags usage);
+    ~PooledBuffer();
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    VkBuffer getHandle() const { return buffer; }
+    VkDeviceSize getSize() const { return size; }
+    // Size of sub-allocated range, rounded up to size class
+    VkDeviceSize getMemorySize() const { return allocation.range.size; }
+    uint32_t getMemoryType() const { return allocation.memoryType; }
+    // Null if memory of pool is not host-visible
+    void *getData() const { return allocation.data; }
+
+private:
+    std::shared_ptr<DeviceMemoryPool> pool;
+    VkBuffer buffer;
+    VkDeviceSize size;
+    DeviceMemoryPool::Allocation allocation;
+};
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "memoryTracker.h"
+#include "platform.h"
+
+MemoryTracker::MemoryTracker(std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 /* nullptr */):
+    physicalDevice(std::move(physicalDevice)),
+    getMemoryProperties2(getMemoryProperties2)
+{
+    vkGetPhysicalDeviceMemoryProperties(*this->physicalDevice, &memoryProperties);
+}
+
+void MemoryTracker::add(const std::string& name, MemoryTag tag, std::shared_ptr<const void> owner,
+    VkDeviceSize size, uint32_t memoryType)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    removeExpired();
+    entries.push_back(Entry{name, tag, memoryProperties.memoryTypes[memoryType].heapIndex, size, owner});
+}
+
+void MemoryTracker::add(const std::string& name, MemoryTag tag, std::shared_ptr<magma::Image> image)
+{   // Images are always allocated from device local memory
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(*image->getDevice(), *image, &requirements);
+    add(name, tag, image, requirements.size,
+        findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+}
+
+void MemoryTracker::add(const std::string& name, MemoryTag tag, std::shared_ptr<magma::Buffer> buffer,
+    VkMemoryPropertyFlags properties)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(*buffer->getDevice(), *buffer, &requirements);
+    add(name, tag, buffer, requirements.size, findMemoryType(requirements.memoryTypeBits, properties));
+}
+
+void MemoryTracker::add(const std::string& name, MemoryTag tag, std::shared_ptr<PooledBuffer> buffer)
+{   // Size of sub-allocated range, including rounding to size class
+    add(name, tag, buffer, buffer->getMemorySize(), buffer->getMemoryType());
+}
+
+std::vector<VkDeviceSize> MemoryTracker::getHeapUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    removeExpired();
+    std::vector<VkDeviceSize> usage(memoryProperties.memoryHeapCount, 0);
+    for (const Entry& entry : entries)
+        usage[entry.heap] += entry.size;
+    return usage;
+}
+
+uint32_t MemoryTracker::warnLiveStaging() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    removeExpired();
+    uint32_t count = 0;
+    for (const Entry& entry : entries)
+    {
+        if (entry.tag != MemoryTag::Staging)
+            continue;
+        std::ostringstream msg;
+        msg << "Warning: staging memory \"" << entry.name << "\" (" << entry.size/1024
+            << " KiB) is kept alive after upload" << std::endl;
+        debugOutput(msg.str().c_str());
+        ++count;
+    }
+    return count;
+}
+
+void MemoryTracker::writeReport(std::ostream& os) const
+{
+    std::vector<Entry> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        removeExpired();
+        sorted = entries;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const Entry& a, const Entry& b)
+        {
+            return a.size > b.size;
+        });
+    VkDeviceSize tagBytes[static_cast<uint32_t>(MemoryTag::Count)] = {};
+    std::vector<VkDeviceSize> heapBytes(memoryProperties.memoryHeapCount, 0);
+    os << "Device memory by resource:" << std::endl;
+    for (const Entry& entry : sorted)
+    {
+        os << "  " << std::left << std::setw(32) << entry.name << std::setw(12) << memoryTagName(entry.tag)
+            << "heap " << entry.heap << std::right << std::setw(10) << entry.size/1024 << " KiB" << std::endl;
+        tagBytes[static_cast<uint32_t>(entry.tag)] += entry.size;
+        heapBytes[entry.heap] += entry.size;
+    }
+    os << "By tag:";
+    for (uint32_t tag = 0; tag < static_cast<uint32_t>(MemoryTag::Count); ++tag)
+        os << " " << memoryTagName(static_cast<MemoryTag>(tag)) << " " << tagBytes[tag]/1024 << " KiB";
+    os << std::endl;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (getMemoryProperties2)
+    {
+        VkPhysicalDeviceMemoryProperties2KHR properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        properties.pNext = &budget;
+        getMemoryProperties2(*physicalDevice, &properties);
+    }
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; ++heap)
+    {
+        const VkMemoryHeap& memoryHeap = memoryProperties.memoryHeaps[heap];
+        os << "Heap " << heap << ((memoryHeap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "")
+            << ": tracked " << heapBytes[heap]/1024 << " KiB of " << memoryHeap.size/(1024 * 1024) << " MiB";
+        if (getMemoryProperties2)
+        {
+            os << ", process usage " << budget.heapUsage[heap]/1024
+                << " KiB, budget " << budget.heapBudget[heap]/(1024 * 1024) << " MiB";
+        }
+        os << std::endl;
+    }
+    if (!getMemoryProperties2)
+        os << "VK_EXT_memory_budget is not supported, driver usage unknown" << std::endl;
+}
+
+uint32_t MemoryTracker::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const
+{   // Same order of search as when memory is allocated
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((memoryTypeBits & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if (memoryTypeBits & (1 << i))
+            return i;
+    }
+    return 0;
+}
+
+void MemoryTracker::removeExpired() const
+{
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+        [](const Entry& entry)
+        {
+            return entry.owner.expired();
+        }),
+        entries.end());
+}
+
+const char *memoryTagName(MemoryTag tag)
+{
+    switch (tag)
+    {
+    case MemoryTag::Mesh: return "mesh";
+    case MemoryTag::Texture: return "texture";
+    case MemoryTag::Attachment: return "attachment";
+    case MemoryTag::Staging: return "staging";
+    case MemoryTag::Uniform: return "uniform";
+    case MemoryTag::Storage: return "storage";
+    default: return "unknown";
+    }
+}
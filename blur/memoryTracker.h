@@ -0,0 +1,64 @@
+#pragma once
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../magma/magma.h"
+#include "memoryPool.h"
+
+enum class MemoryTag : uint32_t
+{
+    Mesh,
+    Texture,
+    Attachment,
+    Staging,
+    Uniform,
+    Storage,
+    Count
+};
+
+// Device memory of tagged resources, grouped by heap. Resources are not
+// unregistered explicitly: entry is dropped once its owner is destroyed.
+// If VK_EXT_memory_budget is available, report includes budget and usage
+// of each heap as seen by the driver (for the whole process).
+class MemoryTracker
+{
+public:
+    explicit MemoryTracker(std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr);
+    // Thread-safe
+    void add(const std::string& name, MemoryTag tag, std::shared_ptr<const void> owner,
+        VkDeviceSize size, uint32_t memoryType);
+    void add(const std::string& name, MemoryTag tag, std::shared_ptr<magma::Image> image);
+    void add(const std::string& name, MemoryTag tag, std::shared_ptr<magma::Buffer> buffer,
+        VkMemoryPropertyFlags properties);
+    void add(const std::string& name, MemoryTag tag, std::shared_ptr<PooledBuffer> buffer);
+    // Live bytes of tracked resources per heap
+    std::vector<VkDeviceSize> getHeapUsage() const;
+    // Prints staging resources that are still alive, returns their count.
+    // Should be called when all uploads have finished.
+    uint32_t warnLiveStaging() const;
+    // Resources sorted by size, totals per tag and per heap
+    void writeReport(std::ostream& os) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        MemoryTag tag;
+        uint32_t heap;
+        VkDeviceSize size;
+        std::weak_ptr<const void> owner;
+    };
+
+    uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const;
+    void removeExpired() const;
+
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    mutable std::mutex mutex;
+    mutable std::vector<Entry> entries;
+};
+
+const char *memoryTagName(MemoryTag tag);
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <fstream>
+#include "pipelineCacheFile.h"
+#include "platform.h"
+#include "hash.h"
+
+namespace
+{
+constexpr uint32_t fileMagic = 0x43505052; // "RPPC"
+constexpr uint32_t fileVersion = 1;
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataSize;
+    uint64_t checksum;
+};
+
+// Header written by driver at the beginning of cache data
+struct CacheHeader
+{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+bool validCacheData(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties)
+{
+    if (data.size() < sizeof(CacheHeader))
+        return false;
+    CacheHeader header;
+    memcpy(&header, data.data(), sizeof(CacheHeader));
+    return header.headerSize >= sizeof(CacheHeader) &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID &&
+        header.deviceID == properties.deviceID &&
+        !memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+std::vector<uint8_t> readCacheFile(const char *fileName, const VkPhysicalDeviceProperties& properties)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return {};
+    const std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(FileHeader)) ||
+        header.magic != fileMagic || header.version != fileVersion)
+    {
+        debugOutput("Pipeline cache file has unknown format\n");
+        return {};
+    }
+    if (header.dataSize != static_cast<uint64_t>(fileSize) - sizeof(FileHeader))
+    {   // Don't allocate whatever size is written in truncated or damaged file
+        debugOutput("Pipeline cache file is corrupted\n");
+        return {};
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(header.dataSize));
+    if (!file.read(reinterpret_cast<char *>(data.data()), data.size()) ||
+        fnv1a(data.data(), data.size()) != header.checksum)
+    {
+        debugOutput("Pipeline cache file is corrupted\n");
+        return {};
+    }
+    if (!validCacheData(data, properties))
+    {   // Driver would ignore it anyway, but some drivers crash on foreign data
+        debugOutput("Pipeline cache file was created by another device or driver\n");
+        return {};
+    }
+    return data;
+}
+} // namespace
+
+std::shared_ptr<magma::PipelineCache> loadPipelineCache(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    const char *fileName, bool& warm)
+{
+    std::vector<uint8_t> data;
+    if (fileName)
+        data = readCacheFile(fileName, physicalDevice->getProperties());
+    warm = !data.empty();
+    return std::make_shared<magma::PipelineCache>(device, data.size(), data.empty() ? nullptr : data.data());
+}
+
+bool savePipelineCache(std::shared_ptr<magma::PipelineCache> pipelineCache,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    const char *fileName)
+{
+    const std::vector<uint8_t> data = pipelineCache->getData();
+    if (!validCacheData(data, physicalDevice->getProperties()))
+        return false;
+    FileHeader header = {fileMagic, fileVersion, data.size(), fnv1a(data.data(), data.size())};
+    std::vector<uint8_t> contents(sizeof(FileHeader) + data.size());
+    memcpy(contents.data(), &header, sizeof(FileHeader));
+    memcpy(contents.data() + sizeof(FileHeader), data.data(), data.size());
+    return writeFileAtomic(fileName, contents.data(), contents.size());
+}
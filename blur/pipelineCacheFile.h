@@ -0,0 +1,13 @@
+#pragma once
+#include "../magma/magma.h"
+
+// Pipeline cache data is stored with header of physical device it was created on
+// and checksum. Mismatching or corrupted file is ignored and overwritten on save.
+
+// Returns empty cache if file doesn't exist or is invalid, warm is set if data was loaded
+std::shared_ptr<magma::PipelineCache> loadPipelineCache(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    const char *fileName, bool& warm);
+bool savePipelineCache(std::shared_ptr<magma::PipelineCache> pipelineCache,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    const char *fileName);
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+#include "platform.h"
+
+void debugOutput(const char *msg)
+{
+#if defined(_WIN32)
+    OutputDebugString(msg);
+#else
+    fputs(msg, stderr);
+#endif
+}
+
+bool writeFileAtomic(const char *fileName, const void *data, size_t size)
+{
+    const std::string tempFileName = std::string(fileName) + ".tmp";
+    FILE *file = fopen(tempFileName.c_str(), "wb");
+    if (!file)
+        return false;
+    bool written = (fwrite(data, 1, size, file) == size) && !fflush(file);
+#if !defined(_WIN32)
+    // Make sure data reaches disk before rename
+    written = written && !fsync(fileno(file));
+#endif
+    written = !fclose(file) && written;
+    if (written)
+    {
+#if defined(_WIN32)
+        written = MoveFileExA(tempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+        written = !rename(tempFileName.c_str(), fileName);
+#endif
+    }
+    if (!written)
+        remove(tempFileName.c_str());
+    return written;
+}
+
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+static xcb_atom_t internAtom(xcb_connection_t *connection, const char *name, bool onlyIfExists)
+{
+    const xcb_intern_atom_cookie_t cookie = xcb_intern_atom(connection, onlyIfExists, static_cast<uint16_t>(strlen(name)), name);
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(connection, cookie, nullptr);
+    if (!reply)
+        return XCB_ATOM_NONE;
+    const xcb_atom_t atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+xcb_atom_t createXcbWindow(AppEntry& entry, const char *title)
+{
+    int screenIndex = 0;
+    xcb_connection_t *connection = xcb_connect(nullptr, &screenIndex);
+    if (xcb_connection_has_error(connection))
+    {
+        xcb_disconnect(connection);
+        throw std::runtime_error("failed to connect to X server");
+    }
+    const xcb_setup_t *setup = xcb_get_setup(connection);
+    xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
+    while (screenIndex-- > 0)
+        xcb_screen_next(&it);
+    xcb_screen_t *screen = it.data;
+
+    const xcb_window_t window = xcb_generate_id(connection);
+    const uint32_t valueMask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
+    const uint32_t values[] = {
+        screen->black_pixel,
+        XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_STRUCTURE_NOTIFY
+    };
+    const int16_t x = static_cast<int16_t>((screen->width_in_pixels - entry.width) / 2);
+    const int16_t y = static_cast<int16_t>((screen->height_in_pixels - entry.height) / 2);
+    xcb_create_window(connection, XCB_COPY_FROM_PARENT, window, screen->root,
+        x, y, static_cast<uint16_t>(entry.width), static_cast<uint16_t>(entry.height), 0,
+        XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+        valueMask, values);
+    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+        static_cast<uint32_t>(strlen(title)), title);
+
+    // Receive notification when window is closed
+    const xcb_atom_t protocols = internAtom(connection, "WM_PROTOCOLS", true);
+    const xcb_atom_t deleteWindow = internAtom(connection, "WM_DELETE_WINDOW", false);
+    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window, protocols, XCB_ATOM_ATOM, 32, 1, &deleteWindow);
+    xcb_map_window(connection, window);
+    xcb_flush(connection);
+
+    entry.connection = connection;
+    entry.window = window;
+    return deleteWindow;
+}
+
+void destroyXcbWindow(AppEntry& entry)
+{
+    xcb_destroy_window(entry.connection, entry.window);
+    xcb_disconnect(entry.connection);
+    entry.connection = nullptr;
+    entry.window = 0;
+}
+#endif // VK_USE_PLATFORM_XCB_KHR
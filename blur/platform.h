@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+#include <windows.h>
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+#include <xcb/xcb.h>
+#endif
+#include <vulkan/vulkan.h>
+
+// Describes where application renders to.
+// If headless is set, no surface is created and frames
+// are rendered to offscreen color attachments.
+struct AppEntry
+{
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+    HINSTANCE hInstance = nullptr;
+    HWND hWnd = nullptr;
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+    xcb_connection_t *connection = nullptr;
+    xcb_window_t window = 0;
+#endif
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool headless = false;
+    bool vSync = false;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAX_ENUM_KHR; // Used if supported by surface
+    const char *pipelineCacheFileName = "pipeline.cache"; // Or nullptr to compile pipelines from scratch
+    const char *assetPackageFileName = "assets.pak"; // Loose files are used if package is absent
+};
+
+void debugOutput(const char *msg);
+// Writes data to temporary file and renames it, so that readers
+// never see partially written file. Returns false on failure.
+bool writeFileAtomic(const char *fileName, const void *data, size_t size);
+
+#if defined(VK_USE_PLATFORM_XCB_KHR)
+// Creates window in the center of the screen and returns WM_DELETE_WINDOW atom
+xcb_atom_t createXcbWindow(AppEntry& entry, const char *title);
+void destroyXcbWindow(AppEntry& entry);
+#endif
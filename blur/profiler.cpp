@@ -0,0 +1,284 @@
+#include <algorithm>
+#include "profiler.h"
+
+Profiler::ScopedSpan::ScopedSpan(Profiler *profiler, const char *name):
+    profiler(profiler),
+    name(name),
+    frame(profiler ? profiler->frameIndex : 0),
+    beginTime(profiler ? profiler->now() : 0.)
+{}
+
+Profiler::ScopedSpan::~ScopedSpan()
+{
+    if (profiler)
+        profiler->addSpan(name, frame, beginTime, profiler->now() - beginTime);
+}
+
+Profiler::Profiler(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    uint32_t queueFamilyIndex,
+    uint32_t slotCount):
+    device(device),
+    slotCount(slotCount),
+    timestampPeriod(physicalDevice->getProperties().limits.timestampPeriod),
+    timestampMask(0),
+    submittedFrames(slotCount, -1),
+    submittedTimes(slotCount, 0.),
+    skippedSections(slotCount, 0),
+    epoch(std::chrono::high_resolution_clock::now()),
+    frameIndex(0),
+    frameBeginTime(0.),
+    frames(maxFrames),
+    frameCount(0),
+    spans(maxSpans),
+    spanCount(0),
+    results(maxSections * 4)
+{
+    const std::vector<VkQueueFamilyProperties> queueFamilies = physicalDevice->getQueueFamilyProperties();
+    const uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    if (validBits)
+    {   // Begin and end timestamp for each section
+        timestampMask = validBits < 64 ? (1ull << validBits) - 1 : ~0ull;
+        timestamps = std::make_shared<magma::TimestampQuery>(device, slotCount * maxSections * 2);
+    }
+    if (physicalDevice->getFeatures().pipelineStatisticsQuery)
+    {   // Should be enabled at device creation
+        const VkQueryPipelineStatisticFlags flags =
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        statistics = std::make_shared<magma::PipelineStatisticsQuery>(device, flags, slotCount * maxSections);
+    }
+    for (auto& frame : frames)
+        frame.sections.reserve(maxSections);
+}
+
+uint32_t Profiler::addSection(const char *name)
+{
+    if (sectionNames.size() >= maxSections)
+        throw std::length_error("too many profiler sections");
+    sectionNames.push_back(name);
+    return static_cast<uint32_t>(sectionNames.size() - 1);
+}
+
+void Profiler::resetSections(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot,
+    uint32_t firstSection, uint32_t sectionCount) const
+{   // Should be called outside of render pass
+    if (timestamps)
+        cmdBuffer->resetQueryPool(timestamps, timestampQuery(slot, firstSection), sectionCount * 2);
+    if (statistics)
+        cmdBuffer->resetQueryPool(statistics, statisticsQuery(slot, firstSection), sectionCount);
+}
+
+void Profiler::beginSection(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot, uint32_t section) const
+{
+    if (timestamps)
+        cmdBuffer->writeTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamps, timestampQuery(slot, section));
+    if (statistics)
+        cmdBuffer->beginQuery(statistics, statisticsQuery(slot, section), false);
+}
+
+void Profiler::endSection(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot, uint32_t section) const
+{
+    if (statistics)
+        cmdBuffer->endQuery(statistics, statisticsQuery(slot, section));
+    if (timestamps)
+        cmdBuffer->writeTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps, timestampQuery(slot, section) + 1);
+}
+
+void Profiler::beginFrame()
+{
+    frameBeginTime = now();
+}
+
+void Profiler::collect(uint32_t slot)
+{
+    if (submittedFrames[slot] < 0)
+        return;
+    Frame& frame = frames[frameCount % maxFrames];
+    frame.index = static_cast<uint64_t>(submittedFrames[slot]);
+    frame.beginTime = submittedTimes[slot];
+    frame.sections.clear();
+    submittedFrames[slot] = -1;
+    const uint32_t skipped = skippedSections[slot];
+    skippedSections[slot] = 0;
+    constexpr VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+    uint64_t reference = 0;
+    bool hasReference = false;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(sectionNames.size()); ++i)
+    {
+        Section section = {sectionNames[i], false, false, 0., 0., 0, 0, 0};
+        uint64_t *ts = &results[i * 4];
+        ts[1] = ts[3] = 0;
+        if (skipped & (1 << i))
+        {
+            section.skipped = true;
+            frame.sections.push_back(section);
+            continue;
+        }
+        if (timestamps)
+        {   // Don't wait, results of slot should be ready as its fence has been signaled
+            vkGetQueryPoolResults(*device, *timestamps, timestampQuery(slot, i), 2,
+                sizeof(uint64_t) * 4, ts, sizeof(uint64_t) * 2, flags);
+            if (ts[1] && ts[3])
+            {   // Counter wraps around at its valid bits
+                ts[0] &= timestampMask;
+                ts[2] &= timestampMask;
+                section.available = true;
+                section.duration = ((ts[2] - ts[0]) & timestampMask) * timestampPeriod * 0.001;
+                if (!hasReference)
+                {
+                    reference = ts[0];
+                    hasReference = true;
+                }
+            }
+        }
+        if (statistics)
+        {   // Vertex invocations, clipping primitives, fragment invocations, availability
+            uint64_t counters[4] = {0};
+            vkGetQueryPoolResults(*device, *statistics, statisticsQuery(slot, i), 1,
+                sizeof(counters), counters, sizeof(counters), flags);
+            if (counters[3])
+            {
+                section.available = true;
+                section.vertexInvocations = counters[0];
+                section.clippingPrimitives = counters[1];
+                section.fragmentInvocations = counters[2];
+            }
+        }
+        frame.sections.push_back(section);
+    }
+    int64_t origin = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(frame.sections.size()); ++i)
+    {
+        const uint64_t *ts = &results[i * 4];
+        if (ts[1] && ts[3])
+            origin = std::min(origin, timestampOffset(reference, ts[0]));
+    }
+    for (uint32_t i = 0; i < static_cast<uint32_t>(frame.sections.size()); ++i)
+    {   // GPU clock domain differs from CPU, so place sections relative to the first one
+        const uint64_t *ts = &results[i * 4];
+        if (ts[1] && ts[3])
+            frame.sections[i].beginTime = (timestampOffset(reference, ts[0]) - origin) * timestampPeriod * 0.001;
+    }
+    ++frameCount;
+}
+
+void Profiler::skipSection(uint32_t slot, uint32_t section)
+{
+    skippedSections[slot] |= 1 << section;
+}
+
+void Profiler::submitted(uint32_t slot)
+{
+    submittedFrames[slot] = static_cast<int64_t>(frameIndex);
+    submittedTimes[slot] = frameBeginTime;
+    ++frameIndex;
+}
+
+const Profiler::Frame *Profiler::getLastFrame() const
+{
+    if (!frameCount)
+        return nullptr;
+    return &frames[(frameCount - 1) % maxFrames];
+}
+
+std::vector<Profiler::Frame> Profiler::getFrameHistory() const
+{
+    std::vector<Frame> history;
+    const uint32_t count = std::min(frameCount, maxFrames);
+    for (uint32_t i = frameCount - count; i < frameCount; ++i)
+        history.push_back(frames[i % maxFrames]);
+    return history;
+}
+
+std::vector<Profiler::Span> Profiler::getSpanHistory() const
+{
+    std::vector<Span> history;
+    const uint32_t count = std::min(spanCount, maxSpans);
+    for (uint32_t i = spanCount - count; i < spanCount; ++i)
+        history.push_back(spans[i % maxSpans]);
+    return history;
+}
+
+void Profiler::writeCsv(std::ostream& os) const
+{
+    os << "type,frame,name,begin_us,duration_us,vertex_invocations,clipping_primitives,fragment_invocations" << std::endl;
+    for (const auto& frame : getFrameHistory())
+    {
+        for (const auto& section : frame.sections)
+        {
+            if (!section.available)
+                continue;
+            os << "gpu," << frame.index << "," << section.name << ","
+                << frame.beginTime + section.beginTime << "," << section.duration << ","
+                << section.vertexInvocations << "," << section.clippingPrimitives << "," << section.fragmentInvocations << std::endl;
+        }
+    }
+    for (const auto& span : getSpanHistory())
+        os << "cpu," << span.frame << "," << span.name << "," << span.beginTime << "," << span.duration << ",,," << std::endl;
+}
+
+void Profiler::writeChromeTrace(std::ostream& os) const
+{   // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    constexpr int cpuThread = 1;
+    constexpr int gpuThread = 2;
+    bool first = true;
+    os << "{\"traceEvents\":[" << std::endl;
+    for (const auto& span : getSpanHistory())
+    {
+        os << (first ? "" : ",\n")
+            << "{\"name\":\"" << span.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << cpuThread
+            << ",\"ts\":" << span.beginTime << ",\"dur\":" << span.duration
+            << ",\"args\":{\"frame\":" << span.frame << "}}";
+        first = false;
+    }
+    for (const auto& frame : getFrameHistory())
+    {
+        for (const auto& section : frame.sections)
+        {
+            if (!section.available)
+                continue;
+            os << (first ? "" : ",\n")
+                << "{\"name\":\"" << section.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << gpuThread
+                << ",\"ts\":" << frame.beginTime + section.beginTime << ",\"dur\":" << section.duration
+                << ",\"args\":{\"frame\":" << frame.index
+                << ",\"vertexInvocations\":" << section.vertexInvocations
+                << ",\"clippingPrimitives\":" << section.clippingPrimitives
+                << ",\"fragmentInvocations\":" << section.fragmentInvocations << "}}";
+            first = false;
+        }
+    }
+    os << std::endl << "]," << std::endl
+        << "\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+double Profiler::now() const
+{
+    const auto time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(time - epoch).count();
+}
+
+void Profiler::addSpan(const char *name, uint64_t frame, double beginTime, double duration)
+{
+    spans[spanCount % maxSpans] = Span{name, frame, beginTime, duration};
+    ++spanCount;
+}
+
+uint32_t Profiler::timestampQuery(uint32_t slot, uint32_t section) const
+{
+    return (slot * maxSections + section) * 2;
+}
+
+uint32_t Profiler::statisticsQuery(uint32_t slot, uint32_t section) const
+{
+    return slot * maxSections + section;
+}
+
+int64_t Profiler::timestampOffset(uint64_t reference, uint64_t timestamp) const
+{   // Signed difference modulo valid bits, sections of a frame are close to each other
+    const uint64_t delta = (timestamp - reference) & timestampMask;
+    if (delta > (timestampMask >> 1))
+        return -static_cast<int64_t>((reference - timestamp) & timestampMask);
+    return static_cast<int64_t>(delta);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <vector>
+#include "../magma/magma.h"
+
+// Collects GPU timestamps and pipeline statistics for named
+// sections of pre-recorded command buffers, plus CPU-side spans.
+// Query results are read back when frame slot is reused, i.e. after
+// its fence has been signaled, so collection never stalls.
+class Profiler
+{
+public:
+    struct Section
+    {
+        const char *name;
+        bool available;
+        bool skipped; // Command buffer wasn't submitted in this frame
+        double beginTime; // Microseconds, relative to CPU frame begin
+        double duration; // Microseconds
+        uint64_t vertexInvocations;
+        uint64_t clippingPrimitives;
+        uint64_t fragmentInvocations;
+    };
+
+    struct Frame
+    {
+        uint64_t index;
+        double beginTime; // Microseconds since profiler creation
+        std::vector<Section> sections;
+    };
+
+    struct Span
+    {
+        const char *name;
+        uint64_t frame;
+        double beginTime; // Microseconds since profiler creation
+        double duration;
+    };
+
+    class ScopedSpan
+    {
+    public:
+        explicit ScopedSpan(Profiler *profiler, const char *name);
+        ~ScopedSpan();
+
+    private:
+        Profiler *profiler;
+        const char *name;
+        uint64_t frame;
+        double beginTime;
+    };
+
+    explicit Profiler(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+        uint32_t queueFamilyIndex,
+        uint32_t slotCount);
+    uint32_t addSection(const char *name);
+    void resetSections(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot,
+        uint32_t firstSection, uint32_t sectionCount) const;
+    void beginSection(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot, uint32_t section) const;
+    void endSection(std::shared_ptr<magma::CommandBuffer> cmdBuffer, uint32_t slot, uint32_t section) const;
+    void beginFrame();
+    void collect(uint32_t slot);
+    // Marks sections whose command buffers are not submitted in the current frame,
+    // so that stale query results of the slot are not reported
+    void skipSection(uint32_t slot, uint32_t section);
+    void submitted(uint32_t slot);
+    const Frame *getLastFrame() const;
+    std::vector<Frame> getFrameHistory() const;
+    std::vector<Span> getSpanHistory() const;
+    void writeCsv(std::ostream& os) const;
+    void writeChromeTrace(std::ostream& os) const;
+
+private:
+    double now() const;
+    void addSpan(const char *name, uint64_t frame, double beginTime, double duration);
+    uint32_t timestampQuery(uint32_t slot, uint32_t section) const;
+    uint32_t statisticsQuery(uint32_t slot, uint32_t section) const;
+    int64_t timestampOffset(uint64_t reference, uint64_t timestamp) const;
+
+    static constexpr uint32_t maxSections = 16;
+    static constexpr uint32_t maxFrames = 1024;
+    static constexpr uint32_t maxSpans = 4096;
+
+    std::shared_ptr<magma::Device> device;
+    std::shared_ptr<magma::QueryPool> timestamps;
+    std::shared_ptr<magma::QueryPool> statistics;
+    const uint32_t slotCount;
+    double timestampPeriod;
+    uint64_t timestampMask; // Valid bits of queue family
+    std::vector<const char *> sectionNames;
+    std::vector<int64_t> submittedFrames;
+    std::vector<double> submittedTimes;
+    std::vector<uint32_t> skippedSections; // Bit mask per slot
+    std::chrono::high_resolution_clock::time_point epoch;
+    uint64_t frameIndex;
+    double frameBeginTime;
+    // Fixed size ring buffers
+    std::vector<Frame> frames;
+    uint32_t frameCount;
+    std::vector<Span> spans;
+    uint32_t spanCount;
+    std::vector<uint64_t> results;
+};
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include "regions.h"
+
+std::vector<VkRect2D> clipRegions(const std::vector<VkRect2D>& regions, const VkExtent2D& extent)
+{
+    std::vector<VkRect2D> clipped;
+    for (const VkRect2D& region : regions)
+    {
+        const int32_t left = std::max(region.offset.x, 0);
+        const int32_t top = std::max(region.offset.y, 0);
+        const int32_t right = std::min(region.offset.x + static_cast<int32_t>(region.extent.width), static_cast<int32_t>(extent.width));
+        const int32_t bottom = std::min(region.offset.y + static_cast<int32_t>(region.extent.height), static_cast<int32_t>(extent.height));
+        if (left < right && top < bottom)
+            clipped.push_back(VkRect2D{{left, top}, {static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)}});
+    }
+    return clipped;
+}
+
+VkRect2D boundingRect(const std::vector<VkRect2D>& regions)
+{
+    if (regions.empty())
+        return VkRect2D{{0, 0}, {0, 0}};
+    int32_t left = regions[0].offset.x, top = regions[0].offset.y;
+    int32_t right = left, bottom = top;
+    for (const VkRect2D& region : regions)
+    {
+        left = std::min(left, region.offset.x);
+        top = std::min(top, region.offset.y);
+        right = std::max(right, region.offset.x + static_cast<int32_t>(region.extent.width));
+        bottom = std::max(bottom, region.offset.y + static_cast<int32_t>(region.extent.height));
+    }
+    return VkRect2D{{left, top}, {static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)}};
+}
+
+std::vector<VkRect2D> subtractRegions(const VkRect2D& rect, const std::vector<VkRect2D>& regions)
+{
+    const int32_t left = rect.offset.x;
+    const int32_t right = rect.offset.x + static_cast<int32_t>(rect.extent.width);
+    const int32_t top = rect.offset.y;
+    const int32_t bottom = rect.offset.y + static_cast<int32_t>(rect.extent.height);
+    // Split rectangle into horizontal bands at top and bottom edges of regions
+    std::vector<int32_t> edges = {top, bottom};
+    for (const VkRect2D& region : regions)
+    {
+        edges.push_back(std::min(std::max(region.offset.y, top), bottom));
+        edges.push_back(std::min(std::max(region.offset.y + static_cast<int32_t>(region.extent.height), top), bottom));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::vector<VkRect2D> uncovered;
+    for (size_t i = 0; i + 1 < edges.size(); ++i)
+    {   // Find spans covered by regions within the band
+        const int32_t y0 = edges[i], y1 = edges[i + 1];
+        std::vector<std::pair<int32_t, int32_t>> spans;
+        for (const VkRect2D& region : regions)
+        {
+            if (region.offset.y <= y0 && region.offset.y + static_cast<int32_t>(region.extent.height) >= y1)
+                spans.emplace_back(region.offset.x, region.offset.x + static_cast<int32_t>(region.extent.width));
+        }
+        std::sort(spans.begin(), spans.end());
+        int32_t x = left;
+        auto addGap = [&uncovered, y0, y1](int32_t x0, int32_t x1)
+        {
+            if (x0 < x1)
+                uncovered.push_back(VkRect2D{{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}});
+        };
+        for (const auto& span : spans)
+        {
+            addGap(x, std::min(span.first, right));
+            x = std::max(x, span.second);
+        }
+        addGap(x, right);
+    }
+    return uncovered;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Clips rectangles to extent and drops empty ones
+std::vector<VkRect2D> clipRegions(const std::vector<VkRect2D>& regions, const VkExtent2D& extent);
+// Smallest rectangle containing all regions
+VkRect2D boundingRect(const std::vector<VkRect2D>& regions);
+// Splits area of rectangle not covered by regions into disjoint rectangles
+std::vector<VkRect2D> subtractRegions(const VkRect2D& rect, const std::vector<VkRect2D>& regions);
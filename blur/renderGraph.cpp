@@ -0,0 +1,230 @@
+#include <stdexcept>
+#include "renderGraph.h"
+#include "barrier.h"
+
+namespace
+{
+constexpr VkAccessFlags writeAccessMask =
+    VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+// Writes image or changes its layout
+bool modifies(const RenderGraph::Access& access)
+{
+    return (access.accessMask & writeAccessMask) || access.discard || (access.layout != access.finalLayout);
+}
+} // namespace
+
+RenderGraph::Access RenderGraph::sampled(Resource resource, VkPipelineStageFlags stageMask /* FRAGMENT_SHADER */)
+{
+    return Access{resource, stageMask, VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+}
+
+RenderGraph::Access RenderGraph::colorAttachment(Resource resource, VkImageLayout finalLayout /* SHADER_READ_ONLY_OPTIMAL */)
+{
+    return Access{resource, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, finalLayout, true};
+}
+
+RenderGraph::Access RenderGraph::loadColorAttachment(Resource resource, VkImageLayout finalLayout)
+{
+    return Access{resource, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout, false};
+}
+
+RenderGraph::Access RenderGraph::storageWrite(Resource resource, VkPipelineStageFlags stageMask /* COMPUTE_SHADER */)
+{
+    return Access{resource, stageMask, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, true};
+}
+
+RenderGraph::Access RenderGraph::transferRead(Resource resource)
+{
+    return Access{resource, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+}
+
+RenderGraph::Access RenderGraph::transferWrite(Resource resource, bool discard /* true */)
+{
+    return Access{resource, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, discard};
+}
+
+RenderGraph::Resource RenderGraph::importImage(const char *name, std::shared_ptr<magma::Image> image,
+    VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+    images.push_back(Image{name, std::move(image), initialLayout, finalLayout, false});
+    return static_cast<Resource>(images.size() - 1);
+}
+
+void RenderGraph::markOutput(Resource resource)
+{
+    images[resource].output = true;
+}
+
+RenderGraph::Pass RenderGraph::addPass(const char *name, std::vector<Access> accesses,
+    std::function<void(std::shared_ptr<magma::CommandBuffer>)> record)
+{
+    for (const Access& access : accesses)
+    {
+        if (access.resource >= images.size())
+            throw std::invalid_argument("pass \"" + std::string(name) + "\" accesses unknown resource");
+    }
+    passes.push_back(Node{name, std::move(accesses), std::move(record), true, false});
+    return static_cast<Pass>(passes.size() - 1);
+}
+
+void RenderGraph::setEnabled(Pass pass, bool enabled)
+{
+    passes[pass].enabled = enabled;
+}
+
+void RenderGraph::record(std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+{
+    cull();
+    std::vector<State> states(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
+        states[i] = State{images[i].initialLayout, false, 0, 0, 0, 0};
+    barrierCount = 0;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (const Node& pass : passes)
+    {
+        if (pass.culled)
+            continue;
+        // All dependencies of the pass are merged into single barrier
+        VkPipelineStageFlags srcStageMask = 0, dstStageMask = 0;
+        VkMemoryBarrier memoryBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, 0, 0};
+        imageBarriers.clear();
+        for (const Access& access : pass.accesses)
+        {
+            State& state = states[access.resource];
+            const bool writes = modifies(access);
+            const bool transition = (access.layout != VK_IMAGE_LAYOUT_UNDEFINED) &&
+                (access.discard || access.layout != state.layout);
+            VkPipelineStageFlags waitStageMask = 0;
+            VkAccessFlags flushAccessMask = 0;
+            if (!state.accessed)
+            {   // Written by commands submitted before
+                waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                flushAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            }
+            else if (writes || transition)
+            {   // Write after write or read
+                waitStageMask = state.writeStageMask | state.readStageMask;
+                flushAccessMask = state.writeAccessMask;
+            }
+            else if (state.writeStageMask && (state.visibleStageMask & access.stageMask) != access.stageMask)
+            {   // Read after write
+                waitStageMask = state.writeStageMask;
+                flushAccessMask = state.writeAccessMask;
+            }
+            if (waitStageMask || transition)
+            {
+                srcStageMask |= waitStageMask ? waitStageMask : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                dstStageMask |= access.stageMask;
+                if (transition)
+                {
+                    imageBarriers.push_back(imageLayoutBarrier(images[access.resource].image,
+                        access.discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout, access.layout,
+                        flushAccessMask, access.accessMask));
+                }
+                else
+                {
+                    memoryBarrier.srcAccessMask |= flushAccessMask;
+                    memoryBarrier.dstAccessMask |= access.accessMask;
+                }
+            }
+            state.accessed = true;
+            state.layout = access.finalLayout;
+            if (writes)
+            {
+                state.writeStageMask = access.stageMask;
+                state.writeAccessMask = access.accessMask & writeAccessMask;
+                state.readStageMask = 0;
+                state.visibleStageMask = 0;
+            }
+            else if (transition)
+            {   // Following reads in other stages have to wait for this one
+                state.writeStageMask = access.stageMask;
+                state.writeAccessMask = 0;
+                state.readStageMask = access.stageMask;
+                state.visibleStageMask = access.stageMask;
+            }
+            else
+            {
+                state.readStageMask |= access.stageMask;
+                state.visibleStageMask |= access.stageMask;
+            }
+        }
+        if (srcStageMask)
+        {
+            const bool hasMemoryBarrier = memoryBarrier.srcAccessMask || memoryBarrier.dstAccessMask;
+            vkCmdPipelineBarrier(*cmdBuffer, srcStageMask, dstStageMask, 0,
+                hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+                0, nullptr,
+                static_cast<uint32_t>(imageBarriers.size()), imageBarriers.empty() ? nullptr : imageBarriers.data());
+            ++barrierCount;
+        }
+        pass.record(cmdBuffer);
+    }
+    // Leave images in layouts expected after graph
+    VkPipelineStageFlags srcStageMask = 0;
+    imageBarriers.clear();
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const State& state = states[i];
+        const VkImageLayout finalLayout = images[i].finalLayout;
+        if (VK_IMAGE_LAYOUT_UNDEFINED == finalLayout || state.layout == finalLayout)
+            continue;
+        if (state.accessed)
+            srcStageMask |= state.writeStageMask | state.readStageMask;
+        else
+            srcStageMask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        imageBarriers.push_back(imageLayoutBarrier(images[i].image, state.layout, finalLayout,
+            state.accessed ? state.writeAccessMask : static_cast<VkAccessFlags>(VK_ACCESS_MEMORY_WRITE_BIT), 0));
+    }
+    if (!imageBarriers.empty())
+    {
+        vkCmdPipelineBarrier(*cmdBuffer, srcStageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        ++barrierCount;
+    }
+}
+
+void RenderGraph::cull()
+{   // Walk back from outputs, pass is needed if it writes contents that somebody reads later
+    std::vector<bool> required(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
+        required[i] = images[i].output;
+    for (auto it = passes.rbegin(); it != passes.rend(); ++it)
+    {
+        Node& pass = *it;
+        bool needed = false;
+        if (pass.enabled)
+        {
+            for (const Access& access : pass.accesses)
+                needed = needed || (modifies(access) && required[access.resource]);
+        }
+        pass.culled = !needed;
+        if (!needed)
+            continue;
+        for (const Access& access : pass.accesses)
+        {   // Earlier writers of overwritten image are not needed
+            if (access.discard)
+                required[access.resource] = false;
+        }
+        for (const Access& access : pass.accesses)
+        {
+            if (!access.discard)
+                required[access.resource] = true;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../magma/magma.h"
+
+// Passes declare how they access images, graph records them in declaration order
+// into single command buffer with barriers and layout transitions derived from
+// these declarations. Passes whose writes don't reach any output are culled.
+// Disabled passes are culled too, their results are expected to be left from
+// previous frames in final layout of the resource.
+class RenderGraph
+{
+public:
+    typedef uint32_t Resource;
+    typedef uint32_t Pass;
+
+    struct Access
+    {
+        Resource resource;
+        VkPipelineStageFlags stageMask;
+        VkAccessFlags accessMask;
+        VkImageLayout layout; // Required by pass, undefined if render pass takes any layout
+        VkImageLayout finalLayout; // Left by pass, differs if render pass transitions image
+        bool discard; // Previous contents aren't needed
+    };
+
+    // Pass samples image in shader
+    static Access sampled(Resource resource, VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    // Render pass clears or doesn't load attachment, final layout is defined by render pass
+    static Access colorAttachment(Resource resource, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Render pass loads attachment in color attachment layout
+    static Access loadColorAttachment(Resource resource, VkImageLayout finalLayout);
+    static Access storageWrite(Resource resource, VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    static Access transferRead(Resource resource);
+    // Whole image is overwritten unless discard is false
+    static Access transferWrite(Resource resource, bool discard = true);
+
+    // Initial layout is undefined if contents are not needed, final layout is set after the last pass
+    Resource importImage(const char *name, std::shared_ptr<magma::Image> image,
+        VkImageLayout initialLayout, VkImageLayout finalLayout);
+    // Contents are used after graph, so its writers are never culled
+    void markOutput(Resource resource);
+    Pass addPass(const char *name, std::vector<Access> accesses,
+        std::function<void(std::shared_ptr<magma::CommandBuffer>)> record);
+    void setEnabled(Pass pass, bool enabled);
+    // Command buffer should be in recording state outside of render pass
+    void record(std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    bool isCulled(Pass pass) const { return passes[pass].culled; }
+    uint32_t getBarrierCount() const { return barrierCount; }
+
+private:
+    struct Image
+    {
+        std::string name;
+        std::shared_ptr<magma::Image> image;
+        VkImageLayout initialLayout;
+        VkImageLayout finalLayout;
+        bool output;
+    };
+
+    struct Node
+    {
+        std::string name;
+        std::vector<Access> accesses;
+        std::function<void(std::shared_ptr<magma::CommandBuffer>)> record;
+        bool enabled;
+        bool culled;
+    };
+
+    // Tracked while passes are recorded
+    struct State
+    {
+        VkImageLayout layout;
+        bool accessed; // By previous pass of this graph
+        VkPipelineStageFlags writeStageMask;
+        VkAccessFlags writeAccessMask;
+        VkPipelineStageFlags readStageMask; // Since last write
+        VkPipelineStageFlags visibleStageMask; // Last write is made visible to
+    };
+
+    void cull();
+
+    std::vector<Image> images;
+    std::vector<Node> passes;
+    uint32_t barrierCount = 0;
+};
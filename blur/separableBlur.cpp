@@ -0,0 +1,150 @@
+#include <algorithm>
+#include "separableBlur.h"
+#include "gaussianKernel.h"
+#include "memoryTracker.h"
+
+SeparableBlur::SeparableBlur(std::shared_ptr<magma::ImageView> imageView,
+    const VkExtent2D& extent,
+    const VkRect2D& bounds,
+    std::shared_ptr<magma::Sampler> sampler,
+    std::shared_ptr<magma::RenderPass> renderPass,
+    const std::vector<magma::PipelineShaderStage>& shaderStages,
+    std::shared_ptr<magma::PipelineCache> pipelineCache):
+    extent(extent),
+    radius(0)
+{
+    std::shared_ptr<magma::Device> device = imageView->getDevice();
+    // Vertical pass needs rows above and below of the bounds
+    const int32_t top = std::max(bounds.offset.y - static_cast<int32_t>(maxRadius), 0);
+    const int32_t bottom = std::min(bounds.offset.y + static_cast<int32_t>(bounds.extent.height + maxRadius),
+        static_cast<int32_t>(extent.height));
+    origin = {bounds.offset.x, top};
+    intermediateExtent = {std::max(bounds.extent.width, 1U), static_cast<uint32_t>(std::max(bottom - top, 1))};
+    // Create intermediate attachment for horizontal pass
+    const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    intermediate = std::make_shared<magma::ColorAttachment2D>(device, format, intermediateExtent, 1, 1);
+    intermediateView = std::make_shared<magma::ImageView>(intermediate);
+    const magma::AttachmentDescription colorAttachment(format, 1, magma::attachments::colorDontCareStoreShaderReadOnly);
+    intermediateRenderPass = std::shared_ptr<magma::RenderPass>(new magma::RenderPass(
+        device, {colorAttachment}));
+    intermediateFramebuffer = std::shared_ptr<magma::Framebuffer>(new magma::Framebuffer(
+        intermediateRenderPass, {intermediateView}));
+
+    horizontalKernel = std::make_shared<magma::UniformBuffer<Kernel>>(device);
+    verticalKernel = std::make_shared<magma::UniformBuffer<Kernel>>(device);
+
+    constexpr magma::Descriptor oneUniformBuffer = magma::descriptors::UniformBuffer(1);
+    constexpr magma::Descriptor oneImageSampler = magma::descriptors::CombinedImageSampler(1);
+    constexpr uint32_t maxDescriptorSets = 2;
+    descriptorPool = std::shared_ptr<magma::DescriptorPool>(new magma::DescriptorPool(device, maxDescriptorSets,
+        {
+            magma::descriptors::UniformBuffer(2),
+            magma::descriptors::CombinedImageSampler(2)
+        }));
+    descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        std::initializer_list<magma::DescriptorSetLayout::Binding>{
+            magma::bindings::FragmentStageBinding(0, oneImageSampler),
+            magma::bindings::FragmentStageBinding(1, oneUniformBuffer)
+        });
+    // Horizontal pass reads source image
+    horizontalDescriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+    horizontalDescriptorSet->update(0, imageView, sampler);
+    horizontalDescriptorSet->update(1, horizontalKernel);
+    // Vertical pass reads result of horizontal pass
+    verticalDescriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+    verticalDescriptorSet->update(0, intermediateView, sampler);
+    verticalDescriptorSet->update(1, verticalKernel);
+    pipelineLayout = std::make_shared<magma::PipelineLayout>(descriptorSetLayout);
+
+    horizontalPipeline = createPipeline(intermediateRenderPass, shaderStages, pipelineCache);
+    verticalPipeline = createPipeline(renderPass, shaderStages, pipelineCache);
+}
+
+void SeparableBlur::setKernel(uint32_t radius, float sigma)
+{
+    this->radius = std::min(radius, maxRadius);
+    const std::vector<LinearTap> taps = linearTaps(this->radius, sigma);
+    auto updateKernel = [&taps](std::shared_ptr<magma::UniformBuffer<Kernel>> buffer,
+        const rapid::float2& direction, const rapid::float4& transform)
+    {
+        magma::helpers::mapScoped<Kernel>(buffer, true, [&taps, &direction, &transform](auto *kernel)
+        {
+            kernel->direction = direction;
+            kernel->tapCount = static_cast<int32_t>(taps.size());
+            kernel->transform = transform;
+            for (size_t i = 0; i < taps.size(); ++i)
+                kernel->taps[i] = rapid::float4(taps[i].offset, taps[i].weight, 0.f, 0.f);
+        });
+    };
+    // Horizontal pass samples source in screen space
+    updateKernel(horizontalKernel, rapid::float2(1.f/extent.width, 0.f),
+        rapid::float4(1.f, 1.f, 0.f, 0.f));
+    // Vertical pass maps screen space to intermediate attachment
+    const float width = static_cast<float>(intermediateExtent.width);
+    const float height = static_cast<float>(intermediateExtent.height);
+    updateKernel(verticalKernel, rapid::float2(0.f, 1.f/height),
+        rapid::float4(extent.width/width, extent.height/height, -origin.x/width, -origin.y/height));
+}
+
+void SeparableBlur::horizontalPass(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad,
+    const std::vector<VkRect2D>& regions) const
+{
+    cmdBuffer->beginRenderPass(intermediateRenderPass, intermediateFramebuffer, {/* don't clear */});
+    {   // Shift screen space viewport to the origin of intermediate attachment
+        cmdBuffer->setViewport(-origin.x, -origin.y, extent.width, extent.height);
+        cmdBuffer->bindVertexBuffer(0, quad);
+        cmdBuffer->bindDescriptorSet(horizontalPipeline, horizontalDescriptorSet);
+        cmdBuffer->bindPipeline(horizontalPipeline);
+        for (const VkRect2D& region : regions)
+        {   // Vertical pass needs rows above and below of the region
+            const int32_t top = std::max(region.offset.y - static_cast<int32_t>(radius), origin.y);
+            const int32_t bottom = std::min(region.offset.y + static_cast<int32_t>(region.extent.height + radius),
+                origin.y + static_cast<int32_t>(intermediateExtent.height));
+            cmdBuffer->setScissor(region.offset.x - origin.x, top - origin.y,
+                region.extent.width, static_cast<uint32_t>(bottom - top));
+            cmdBuffer->draw(4);
+        }
+    }
+    cmdBuffer->endRenderPass();
+}
+
+void SeparableBlur::verticalPass(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+    std::shared_ptr<magma::VertexBuffer> quad) const
+{   // Viewport and scissor are set by caller
+    cmdBuffer->bindVertexBuffer(0, quad);
+    cmdBuffer->bindDescriptorSet(verticalPipeline, verticalDescriptorSet);
+    cmdBuffer->bindPipeline(verticalPipeline);
+    cmdBuffer->draw(4);
+}
+
+void SeparableBlur::trackMemory(MemoryTracker& tracker) const
+{
+    tracker.add("separableBlur.intermediate", MemoryTag::Attachment, intermediate);
+    tracker.add("separableBlur.horizontalKernel", MemoryTag::Uniform, horizontalKernel,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    tracker.add("separableBlur.verticalKernel", MemoryTag::Uniform, verticalKernel,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+std::shared_ptr<magma::GraphicsPipeline> SeparableBlur::createPipeline(std::shared_ptr<magma::RenderPass> renderPass,
+    const std::vector<magma::PipelineShaderStage>& shaderStages,
+    std::shared_ptr<magma::PipelineCache> pipelineCache) const
+{
+    return std::make_shared<magma::GraphicsPipeline>(renderPass->getDevice(),
+        shaderStages,
+        magma::renderstates::pos2f,
+        magma::renderstates::triangleStrip,
+        magma::renderstates::fillCullNoneCW,
+        magma::renderstates::dontMultisample,
+        magma::renderstates::depthAlwaysDontWrite,
+        magma::renderstates::dontBlendRgb,
+        std::initializer_list<VkDynamicState>{
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        },
+        pipelineLayout,
+        renderPass, 0,
+        pipelineCache,
+        nullptr, nullptr, 0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../magma/magma.h"
+#include "../rapid/rapid.h"
+
+class MemoryTracker;
+
+// Gaussian blur in two passes: horizontal pass renders to intermediate
+// attachment, vertical pass samples it and draws to the target render pass.
+// Adjacent taps are merged into single bilinear fetches, so cost grows
+// linearly with radius. Intermediate attachment covers only bounds of
+// blurred regions plus vertical apron.
+class SeparableBlur
+{
+public:
+    static constexpr uint32_t maxTaps = 32;
+    static constexpr uint32_t maxRadius = (maxTaps - 1)/2 * 2; // Two texels per tap on each side
+
+    explicit SeparableBlur(std::shared_ptr<magma::ImageView> imageView,
+        const VkExtent2D& extent,
+        const VkRect2D& bounds,
+        std::shared_ptr<magma::Sampler> sampler,
+        std::shared_ptr<magma::RenderPass> renderPass,
+        const std::vector<magma::PipelineShaderStage>& shaderStages,
+        std::shared_ptr<magma::PipelineCache> pipelineCache);
+    void setKernel(uint32_t radius, float sigma);
+    uint32_t getRadius() const { return radius; }
+    // Regions should be inside of bounds
+    void horizontalPass(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad,
+        const std::vector<VkRect2D>& regions) const;
+    void verticalPass(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
+        std::shared_ptr<magma::VertexBuffer> quad) const;
+    std::shared_ptr<magma::Image> getIntermediate() const { return intermediate; }
+    std::shared_ptr<magma::ImageView> getIntermediateView() const { return intermediateView; }
+    void trackMemory(MemoryTracker& tracker) const;
+
+private:
+    struct alignas(16) Kernel
+    {
+        rapid::float2 direction;
+        int32_t tapCount;
+        int32_t pad;
+        rapid::float4 transform; // xy - scale, zw - offset of texture coordinates
+        rapid::float4 taps[maxTaps];
+    };
+
+    std::shared_ptr<magma::GraphicsPipeline> createPipeline(std::shared_ptr<magma::RenderPass> renderPass,
+        const std::vector<magma::PipelineShaderStage>& shaderStages,
+        std::shared_ptr<magma::PipelineCache> pipelineCache) const;
+
+    VkExtent2D extent;
+    VkOffset2D origin; // Of intermediate attachment in screen space
+    VkExtent2D intermediateExtent;
+    uint32_t radius;
+    std::shared_ptr<magma::ColorAttachment2D> intermediate;
+    std::shared_ptr<magma::ImageView> intermediateView;
+    std::shared_ptr<magma::RenderPass> intermediateRenderPass;
+    std::shared_ptr<magma::Framebuffer> intermediateFramebuffer;
+    std::shared_ptr<magma::UniformBuffer<Kernel>> horizontalKernel;
+    std::shared_ptr<magma::UniformBuffer<Kernel>> verticalKernel;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> descriptorSetLayout;
+    std::shared_ptr<magma::DescriptorSet> horizontalDescriptorSet;
+    std::shared_ptr<magma::DescriptorSet> verticalDescriptorSet;
+    std::shared_ptr<magma::PipelineLayout> pipelineLayout;
+    std::shared_ptr<magma::GraphicsPipeline> horizontalPipeline;
+    std::shared_ptr<magma::GraphicsPipeline> verticalPipeline;
+};
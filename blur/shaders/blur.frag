@@ -1,39 +1,37 @@
 #version 450
 
-#define M 7
-#define N M
+// Kernel radius and normalized 1D weights are computed on the host
+// and baked into pipeline, so there is no transcendental math per tap.
+layout(constant_id = 0) const int RADIUS = 3;
+layout(constant_id = 1) const float W0 = 1.;
+layout(constant_id = 2) const float W1 = 0.;
+layout(constant_id = 3) const float W2 = 0.;
+layout(constant_id = 4) const float W3 = 0.;
+layout(constant_id = 5) const float W4 = 0.;
+layout(constant_id = 6) const float W5 = 0.;
+layout(constant_id = 7) const float W6 = 0.;
+layout(constant_id = 8) const float W7 = 0.;
+layout(constant_id = 9) const float W8 = 0.;
+
+const float weights[9] = float[](W0, W1, W2, W3, W4, W5, W6, W7, W8);
 
 layout(location = 0) in vec2 texCoord;
 layout(location = 0) out vec4 oColor;
 
 layout(binding = 0) uniform sampler2D offscreen;
 
-float gaussian(float sigma, int x)
-{
-    float d = float(x * x)/(2. * sigma * sigma);
-    return exp(-d);
-}
-
 void main()
 {
-    const int m = M/2, n = N/2;
-    const float sigma = 4.;
-
-    vec2 texSize = 1./textureSize(offscreen, 0);
-
-    for (int y = -n; y <= n; ++y)
+    vec2 texelSize = 1./textureSize(offscreen, 0);
+    vec4 color = vec4(0.);
+    for (int y = -RADIUS; y <= RADIUS; ++y)
     {
-        float fy = gaussian(sigma, y);
-        for (int x = -m; x <= m; ++x)
-        {
-            float fx = gaussian(sigma, x);
-            float weight = fx * fy;
-            vec2 duv = vec2(x, y) * texSize;
-
-            oColor.rgb += texture(offscreen, texCoord + duv).rgb * weight;
-            oColor.w += weight;
+        for (int x = -RADIUS; x <= RADIUS; ++x)
+        {   // Kernel is separable, so 2D weight is product of 1D weights
+            float weight = weights[abs(x)] * weights[abs(y)];
+            vec2 duv = vec2(x, y) * texelSize;
+            color += texture(offscreen, texCoord + duv) * weight;
         }
     }
-
-    oColor /= oColor.w;
+    oColor = color;
 }
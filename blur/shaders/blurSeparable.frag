@@ -0,0 +1,25 @@
+#version 450
+
+#define MAX_TAPS 32
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 oColor;
+
+layout(binding = 0) uniform sampler2D image;
+layout(binding = 1) uniform Kernel
+{
+    vec2 direction; // Texel size along blur axis
+    int tapCount;
+    vec4 transform; // xy - scale, zw - offset of texture coordinates
+    vec4 taps[MAX_TAPS]; // x - offset in texels, y - weight
+};
+
+void main()
+{
+    // Each tap fetches two adjacent texels using bilinear filtering
+    vec2 uv = texCoord * transform.xy + transform.zw;
+    vec4 color = vec4(0.);
+    for (int i = 0; i < tapCount; ++i)
+        color += texture(image, uv + direction * taps[i].x) * taps[i].y;
+    oColor = color;
+}
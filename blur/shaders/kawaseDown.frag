@@ -0,0 +1,22 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 oColor;
+
+layout(binding = 0) uniform sampler2D image;
+layout(binding = 1) uniform Pyramid
+{
+    float offset; // Tap distance in half texels
+};
+
+void main()
+{
+    // Center and four diagonal bilinear taps, each averaging 2x2 texels
+    vec2 halfTexel = 0.5/textureSize(image, 0) * offset;
+    vec4 color = texture(image, texCoord) * 4.;
+    color += texture(image, texCoord - halfTexel);
+    color += texture(image, texCoord + halfTexel);
+    color += texture(image, texCoord + vec2(halfTexel.x, -halfTexel.y));
+    color += texture(image, texCoord - vec2(halfTexel.x, -halfTexel.y));
+    oColor = color/8.;
+}
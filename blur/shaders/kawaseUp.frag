@@ -0,0 +1,25 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 oColor;
+
+layout(binding = 0) uniform sampler2D image;
+layout(binding = 1) uniform Pyramid
+{
+    float offset; // Tap distance in half texels
+};
+
+void main()
+{
+    // Tent filter of eight taps around the center
+    vec2 halfTexel = 0.5/textureSize(image, 0) * offset;
+    vec4 color = texture(image, texCoord + vec2(-halfTexel.x * 2., 0.));
+    color += texture(image, texCoord + vec2(-halfTexel.x, halfTexel.y)) * 2.;
+    color += texture(image, texCoord + vec2(0., halfTexel.y * 2.));
+    color += texture(image, texCoord + vec2(halfTexel.x, halfTexel.y)) * 2.;
+    color += texture(image, texCoord + vec2(halfTexel.x * 2., 0.));
+    color += texture(image, texCoord + vec2(halfTexel.x, -halfTexel.y)) * 2.;
+    color += texture(image, texCoord + vec2(0., -halfTexel.y * 2.));
+    color += texture(image, texCoord + vec2(-halfTexel.x, -halfTexel.y)) * 2.;
+    oColor = color/12.;
+}
@@ -1,6 +1,7 @@
 #version 450
 
 #define LIGHT_POS vec4(-3., 3., 5., 1.)
+#define SURFACE_MATERIALS 4
 
 struct Material
 {
@@ -8,25 +9,24 @@ struct Material
     vec3 diffuse;
     vec3 specular;
     float shininess;
+    uint textureIndex; // Used in bindless mode
 };
 
 layout(location = 0) in vec3 viewPos;
 layout(location = 1) in vec3 viewNormal;
 layout(location = 2) in vec2 texCoord;
+layout(location = 3) flat in uint material;
 layout(location = 0) out vec4 oColor;
 
 layout(binding = 0) uniform Transforms
 {
-    mat4 normalMatrix;
     mat4 view;
-    mat4 worldView;
-    mat4 worldViewProj;
 };
 
 layout(binding = 1) uniform Materials
 {
     Material light;
-    Material surface;
+    Material surfaces[SURFACE_MATERIALS]; // Selected by instance
 };
 
 layout(binding = 2) uniform sampler2D diffuse;
@@ -45,6 +45,7 @@ vec3 phong(vec3 N, vec3 L, vec3 V,
 
 void main()
 {
+    Material surface = surfaces[material];
     vec3 diffuse = texture(diffuse, texCoord).rgb;
     vec3 lightViewPos = (view * LIGHT_POS).xyz;
 
@@ -0,0 +1,65 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define LIGHT_POS vec4(-3., 3., 5., 1.)
+#define MAX_TEXTURES 16
+
+struct Material
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+    uint textureIndex;
+};
+
+layout(location = 0) in vec3 viewPos;
+layout(location = 1) in vec3 viewNormal;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) flat in uint material;
+layout(location = 0) out vec4 oColor;
+
+layout(binding = 0) uniform Transforms
+{
+    mat4 view;
+};
+
+// Materials are added without touching descriptors
+layout(std430, binding = 1) readonly buffer Materials
+{
+    Material light;
+    Material surfaces[]; // Selected by instance
+};
+
+layout(binding = 2) uniform sampler2D textures[MAX_TEXTURES];
+
+vec3 phong(vec3 N, vec3 L, vec3 V,
+           vec3 Ka, vec3 Ia,
+           vec3 Kd, vec3 Id,
+           vec3 Ks, vec3 Is,
+           float e)
+{
+    float NdL = max(dot(N, L), 0.);
+    vec3 R = reflect(-L, N);
+    float RdV = max(dot(R, V), 0.);
+    return (Ka * Ia) + (Kd * NdL * Id) + (Ks * pow(RdV, e) * Is);
+}
+
+void main()
+{
+    Material surface = surfaces[material];
+    // Instances of one draw may use different textures
+    vec3 diffuse = texture(textures[nonuniformEXT(surface.textureIndex)], texCoord).rgb;
+    vec3 lightViewPos = (view * LIGHT_POS).xyz;
+
+    vec3 N = normalize(viewNormal);
+    vec3 L = normalize(lightViewPos - viewPos);
+    vec3 V = normalize(-viewPos); // view position at (0,0,0)
+
+    vec3 color = phong(N, L, V,
+        light.ambient, surface.ambient * diffuse,
+        light.diffuse, surface.diffuse * diffuse,
+        light.specular, surface.specular,
+        surface.shininess);
+    oColor = vec4(color, 1.);
+}
@@ -4,26 +4,35 @@ layout(location = 0) in vec4 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 texCoord;
 
-layout(binding = 0) uniform Transforms
+struct Instance
 {
-    mat4 normalMatrix;
-    mat4 view;
-    mat4 worldView;
+    mat4 worldView; // Uniform scale only
     mat4 worldViewProj;
+    uint material;
+};
+
+// Rebuilt on CPU for every frame
+layout(std430, binding = 3) readonly buffer Instances
+{
+    Instance instances[];
 };
 
 layout(location = 0) out vec3 oViewPos;
 layout(location = 1) out vec3 oViewNormal;
 layout(location = 2) out vec2 oTexCoord;
+layout(location = 3) flat out uint oMaterial;
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
 void main()
 {
-    oViewPos = (worldView * position).xyz;
-    oViewNormal = (normalMatrix * vec4(normal, 1.)).xyz;
+    Instance instance = instances[gl_InstanceIndex];
+    oViewPos = (instance.worldView * position).xyz;
+    // No non-uniform scale, so upper 3x3 transforms normals as well
+    oViewNormal = mat3(instance.worldView) * normal;
     oTexCoord = texCoord;
-    gl_Position = worldViewProj * position;
+    oMaterial = instance.material;
+    gl_Position = instance.worldViewProj * position;
     gl_Position.y = -gl_Position.y;
 }
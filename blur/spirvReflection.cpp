@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include "spirvReflection.h"
+#include "platform.h"
+
+namespace
+{
+constexpr uint32_t spirvMagic = 0x07230203;
+constexpr uint32_t spirvHeaderSize = 5; // In words
+constexpr uint32_t opEntryPoint = 15;
+constexpr uint32_t opDecorate = 71;
+constexpr uint32_t decorationBinding = 33;
+constexpr uint32_t decorationDescriptorSet = 34;
+
+constexpr uint32_t fileMagic = 0x4c465252; // "RRFL"
+constexpr uint32_t fileVersion = 1;
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t bytecodeHash;
+    uint32_t stage;
+    uint32_t entryPointLength;
+    uint32_t bindingCount;
+    uint32_t reserved;
+};
+
+VkShaderStageFlagBits executionModelStage(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default: return VK_SHADER_STAGE_ALL;
+    }
+}
+} // namespace
+
+bool reflectSpirv(const uint32_t *words, size_t wordCount, ShaderReflection& reflection)
+{
+    if (wordCount < spirvHeaderSize || words[0] != spirvMagic)
+        return false;
+    reflection = ShaderReflection();
+    std::map<uint32_t, ShaderBinding> bindings; // By variable id
+    std::map<uint32_t, bool> hasBinding;
+    for (size_t i = spirvHeaderSize; i < wordCount;)
+    {
+        const uint32_t opcode = words[i] & 0xFFFF;
+        const uint32_t length = words[i] >> 16;
+        if (!length || i + length > wordCount)
+            return false;
+        if (opEntryPoint == opcode && length >= 4 && reflection.entryPoint.empty())
+        {   // Name is nul-terminated literal string packed into words
+            const char *name = reinterpret_cast<const char *>(words + i + 3);
+            const size_t maxLength = (length - 3) * sizeof(uint32_t);
+            reflection.stage = executionModelStage(words[i + 1]);
+            reflection.entryPoint.assign(name, strnlen(name, maxLength));
+        }
+        else if (opDecorate == opcode && length >= 4)
+        {
+            const uint32_t id = words[i + 1];
+            if (decorationBinding == words[i + 2])
+            {
+                bindings[id].binding = words[i + 3];
+                hasBinding[id] = true;
+            }
+            else if (decorationDescriptorSet == words[i + 2])
+                bindings[id].set = words[i + 3];
+        }
+        i += length;
+    }
+    if (reflection.entryPoint.empty())
+        return false;
+    for (const auto& it : bindings)
+    {
+        if (hasBinding[it.first])
+            reflection.bindings.push_back(it.second);
+    }
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+        [](const ShaderBinding& a, const ShaderBinding& b)
+        {
+            return (a.set < b.set) || (a.set == b.set && a.binding < b.binding);
+        });
+    return true;
+}
+
+bool loadReflection(const char *fileName, uint64_t bytecodeHash, ShaderReflection& reflection)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    const std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(FileHeader)) ||
+        header.magic != fileMagic ||
+        header.version != fileVersion ||
+        header.bytecodeHash != bytecodeHash)
+        return false; // Shader has been recompiled
+    // Sizes come from file, don't allocate more than it holds
+    const uint64_t contentsSize = uint64_t(header.entryPointLength) + uint64_t(header.bindingCount) * sizeof(ShaderBinding);
+    if (!header.entryPointLength || contentsSize != static_cast<uint64_t>(fileSize) - sizeof(FileHeader))
+        return false;
+    reflection.stage = static_cast<VkShaderStageFlagBits>(header.stage);
+    reflection.entryPoint.resize(header.entryPointLength);
+    reflection.bindings.resize(header.bindingCount);
+    if (!file.read(&reflection.entryPoint[0], header.entryPointLength))
+        return false;
+    if (header.bindingCount &&
+        !file.read(reinterpret_cast<char *>(reflection.bindings.data()), header.bindingCount * sizeof(ShaderBinding)))
+        return false;
+    return true;
+}
+
+bool saveReflection(const char *fileName, uint64_t bytecodeHash, const ShaderReflection& reflection)
+{
+    const FileHeader header = {fileMagic, fileVersion, bytecodeHash,
+        static_cast<uint32_t>(reflection.stage),
+        static_cast<uint32_t>(reflection.entryPoint.size()),
+        static_cast<uint32_t>(reflection.bindings.size()),
+        0};
+    const size_t bindingsSize = reflection.bindings.size() * sizeof(ShaderBinding);
+    std::vector<char> contents(sizeof(FileHeader) + reflection.entryPoint.size() + bindingsSize);
+    char *ptr = contents.data();
+    memcpy(ptr, &header, sizeof(FileHeader));
+    ptr += sizeof(FileHeader);
+    memcpy(ptr, reflection.entryPoint.data(), reflection.entryPoint.size());
+    ptr += reflection.entryPoint.size();
+    if (bindingsSize)
+        memcpy(ptr, reflection.bindings.data(), bindingsSize);
+    return writeFileAtomic(fileName, contents.data(), contents.size());
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct ShaderBinding
+{
+    uint32_t set;
+    uint32_t binding;
+};
+
+// The only reflection data needed to create pipeline shader stage
+struct ShaderReflection
+{
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+    std::string entryPoint;
+    std::vector<ShaderBinding> bindings; // Sorted by set and binding
+};
+
+// Scans instructions for the first entry point and descriptor decorations
+bool reflectSpirv(const uint32_t *words, size_t wordCount, ShaderReflection& reflection);
+// Sidecar file is valid only for bytecode with the same hash
+bool loadReflection(const char *fileName, uint64_t bytecodeHash, ShaderReflection& reflection);
+bool saveReflection(const char *fileName, uint64_t bytecodeHash, const ShaderReflection& reflection);
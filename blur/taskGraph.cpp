@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include "taskGraph.h"
+
+TaskGraph::Task TaskGraph::add(const char *name, std::function<void()> body, std::initializer_list<Task> dependencies)
+{
+    const Task task = static_cast<Task>(nodes.size());
+    for (Task dependency : dependencies)
+    {
+        if (dependency >= task)
+            throw std::invalid_argument("task may depend only on previously added tasks");
+        nodes[dependency].dependents.push_back(task);
+    }
+    nodes.push_back(Node{name, std::move(body), dependencies, {}, 0, 0., 0., false});
+    return task;
+}
+
+void TaskGraph::run(ThreadPool& threadPool)
+{
+    begin = std::chrono::high_resolution_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    finishedCount = 0;
+    exception = nullptr;
+    for (Node& node : nodes)
+    {
+        node.pendingCount = static_cast<uint32_t>(node.dependencies.size());
+        node.skipped = false;
+    }
+    for (Task task = 0; task < nodes.size(); ++task)
+    {
+        if (!nodes[task].pendingCount)
+            schedule(threadPool, task);
+    }
+    finished.wait(lock, [this]() { return finishedCount == nodes.size(); });
+    duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+std::vector<TaskGraph::Task> TaskGraph::getCriticalPath() const
+{
+    std::vector<Task> path;
+    if (nodes.empty())
+        return path;
+    auto byEnd = [this](Task a, Task b) { return nodes[a].end < nodes[b].end; };
+    std::vector<Task> all(nodes.size());
+    for (Task task = 0; task < nodes.size(); ++task)
+        all[task] = task;
+    Task task = *std::max_element(all.begin(), all.end(), byEnd);
+    for (;;)
+    {   // Walk back through dependency that kept task waiting
+        path.push_back(task);
+        const std::vector<Task>& dependencies = nodes[task].dependencies;
+        if (dependencies.empty())
+            break;
+        task = *std::max_element(dependencies.begin(), dependencies.end(), byEnd);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void TaskGraph::printTimings(std::ostream& os) const
+{
+    const std::vector<Task> path = getCriticalPath();
+    double pathSum = 0.;
+    os << std::fixed << std::setprecision(2);
+    for (Task task = 0; task < nodes.size(); ++task)
+    {
+        const Node& node = nodes[task];
+        const bool critical = std::find(path.begin(), path.end(), task) != path.end();
+        if (critical)
+            pathSum += node.end - node.start;
+        os << (critical ? "* " : "  ") << std::left << std::setw(24) << node.name << std::right
+            << " start " << std::setw(8) << node.start << " ms, took " << std::setw(8) << node.end - node.start << " ms"
+            << (node.skipped ? " (skipped)" : "") << std::endl;
+    }
+    os << "total " << duration << " ms, critical path busy " << pathSum << " ms" << std::endl;
+}
+
+void TaskGraph::schedule(ThreadPool& threadPool, Task task)
+{   // Called under lock
+    if (exception)
+    {   // Don't run dependents of failed task
+        nodes[task].skipped = true;
+        finish(threadPool, task);
+        return;
+    }
+    threadPool.submit([this, &threadPool, task]()
+    {
+        Node& node = nodes[task];
+        node.start = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        std::exception_ptr error;
+        try
+        {
+            node.body();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        node.end = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error && !exception)
+            exception = error;
+        finish(threadPool, task);
+    });
+}
+
+void TaskGraph::finish(ThreadPool& threadPool, Task task)
+{   // Called under lock
+    Node& node = nodes[task];
+    if (node.skipped)
+        node.start = node.end = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    for (Task dependent : node.dependents)
+    {
+        if (!--nodes[dependent].pendingCount)
+            schedule(threadPool, dependent);
+    }
+    if (++finishedCount == nodes.size())
+        finished.notify_all();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "threadPool.h"
+
+// Runs tasks on thread pool as soon as their dependencies are finished.
+// Task may depend only on tasks added before it, so graph can't have cycles.
+class TaskGraph
+{
+public:
+    typedef uint32_t Task;
+
+    Task add(const char *name, std::function<void()> body, std::initializer_list<Task> dependencies = {});
+    // Waits for all tasks and rethrows first exception, if any.
+    // Dependents of failed task are not run.
+    void run(ThreadPool& threadPool);
+    double getDuration() const { return duration; }
+    // Chain of dependencies that finished last, ends with the last finished task
+    std::vector<Task> getCriticalPath() const;
+    // Start and duration of each task in milliseconds, critical path marked with *
+    void printTimings(std::ostream& os) const;
+
+private:
+    struct Node
+    {
+        std::string name;
+        std::function<void()> body;
+        std::vector<Task> dependencies;
+        std::vector<Task> dependents;
+        uint32_t pendingCount;
+        double start;
+        double end;
+        bool skipped;
+    };
+
+    void schedule(ThreadPool& threadPool, Task task);
+    void finish(ThreadPool& threadPool, Task task);
+
+    std::vector<Node> nodes;
+    std::chrono::high_resolution_clock::time_point begin;
+    std::mutex mutex;
+    std::condition_variable finished;
+    uint32_t finishedCount = 0;
+    std::exception_ptr exception;
+    double duration = 0.;
+};
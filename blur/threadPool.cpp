@@ -0,0 +1,115 @@
+#include <algorithm>
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount /* 0 */):
+    stop(false)
+{
+    if (!threadCount)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+    for (uint32_t i = 0; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> future = packagedTask.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(packagedTask));
+    }
+    condition.notify_one();
+    return future;
+}
+
+void ThreadPool::runJob(uint32_t count, ChunkFunction function, const void *body)
+{   // Few chunks per thread to balance uneven work
+    const uint32_t chunkCount = std::min(count, (getThreadCount() + 1) * 4);
+    if (chunkCount <= 1)
+    {
+        if (count)
+            function(body, 0, count);
+        return;
+    }
+    std::lock_guard<std::mutex> jobLock(jobMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job.function = function;
+        job.body = body;
+        job.count = count;
+        job.chunkCount = chunkCount;
+        job.doneChunks = 0;
+        job.nextChunk = 0;
+    }
+    condition.notify_all();
+    const uint32_t doneChunks = runChunks();
+    std::exception_ptr exception;
+    {   // Descriptor is reused once the last worker has left it
+        std::unique_lock<std::mutex> lock(mutex);
+        job.doneChunks += doneChunks;
+        jobFinished.wait(lock, [this]() { return job.doneChunks == job.chunkCount && !job.helperCount; });
+        std::swap(exception, job.exception);
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+uint32_t ThreadPool::runChunks()
+{
+    uint32_t doneChunks = 0;
+    for (uint32_t i; (i = job.nextChunk++) < job.chunkCount; ++doneChunks)
+    {
+        const uint32_t begin = static_cast<uint32_t>(uint64_t(job.count) * i / job.chunkCount);
+        const uint32_t end = static_cast<uint32_t>(uint64_t(job.count) * (i + 1) / job.chunkCount);
+        try
+        {
+            job.function(job.body, begin, end);
+        }
+        catch (...)
+        {   // Rethrown by calling thread
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!job.exception)
+                job.exception = std::current_exception();
+        }
+    }
+    return doneChunks;
+}
+
+void ThreadPool::run()
+{
+    for (;;)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stop || !tasks.empty() || hasChunks(); });
+            if (hasChunks())
+            {   // Chunks of parallelFor go before queued tasks
+                ++job.helperCount;
+                lock.unlock();
+                const uint32_t doneChunks = runChunks();
+                lock.lock();
+                job.doneChunks += doneChunks;
+                if (!--job.helperCount)
+                    jobFinished.notify_one();
+                continue;
+            }
+            if (stop && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
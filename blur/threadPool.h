@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing tasks in submission order
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint32_t threadCount = 0); // Zero means hardware concurrency
+    ~ThreadPool();
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+    std::future<void> submit(std::function<void()> task);
+    // Splits range [0, count) into chunks, processed by workers and calling thread,
+    // and waits until all of them are done. Doesn't allocate.
+    template<typename Body>
+    void parallelFor(uint32_t count, const Body& body)
+    {
+        runJob(count, [](const void *body, uint32_t begin, uint32_t end)
+        {
+            (*static_cast<const Body *>(body))(begin, end);
+        }, &body);
+    }
+
+private:
+    typedef void (*ChunkFunction)(const void *body, uint32_t begin, uint32_t end);
+
+    // Preallocated descriptor of parallelFor in flight
+    struct Job
+    {
+        ChunkFunction function = nullptr;
+        const void *body = nullptr;
+        uint32_t count = 0;
+        uint32_t chunkCount = 0;
+        std::atomic<uint32_t> nextChunk{0};
+        uint32_t doneChunks = 0;
+        uint32_t helperCount = 0; // Workers taking chunks
+        std::exception_ptr exception;
+    };
+
+    void run();
+    void runJob(uint32_t count, ChunkFunction function, const void *body);
+    uint32_t runChunks();
+    bool hasChunks() const { return job.nextChunk.load() < job.chunkCount; }
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop;
+    Job job;
+    std::mutex jobMutex; // One parallelFor at a time
+    std::condition_variable jobFinished;
+};
@@ -0,0 +1,151 @@
+#include <cstddef>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include "transformSystem.h"
+#include "threadPool.h"
+
+namespace
+{
+// Element of matrix for all four lanes
+inline void broadcast(const float *m, __m128 out[16])
+{
+    for (int i = 0; i < 16; ++i)
+        out[i] = _mm_set1_ps(m[i]);
+}
+
+// Row-vector convention, a holds four matrices, b is broadcasted
+inline void multiply(const __m128 a[16], const __m128 b[16], __m128 out[16])
+{
+    for (int row = 0; row < 4; ++row)
+    {
+        const __m128 *r = a + row * 4;
+        for (int col = 0; col < 4; ++col)
+        {
+            __m128 sum = _mm_mul_ps(r[0], b[col]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(r[1], b[4 + col]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(r[2], b[8 + col]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(r[3], b[12 + col]));
+            out[row * 4 + col] = sum;
+        }
+    }
+}
+
+// Transposes lanes back into four row-major matrices
+inline void store(__m128 m[16], TransformSystem::Instance *instances, size_t offset)
+{
+    for (int row = 0; row < 4; ++row)
+    {
+        __m128 *r = m + row * 4;
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        for (int i = 0; i < 4; ++i)
+        {   // Bypass cache, output is write-combined memory in most cases
+            float *dst = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(instances + i) + offset);
+            _mm_stream_ps(dst + row * 4, r[i]);
+        }
+    }
+}
+} // namespace
+
+uint32_t TransformSystem::add(float x, float y, float z,
+    float qx, float qy, float qz, float qw,
+    float scale, uint32_t material)
+{
+    static_assert(sizeof(rapid::matrix) == 16 * sizeof(float), "unexpected matrix layout");
+    if (count == getPaddedCount())
+    {   // Next group, unused lanes have zero scale
+        const size_t size = count + 4;
+        positionX.resize(size, 0.f); positionY.resize(size, 0.f); positionZ.resize(size, 0.f);
+        rotationX.resize(size, 0.f); rotationY.resize(size, 0.f); rotationZ.resize(size, 0.f); rotationW.resize(size, 1.f);
+        this->scale.resize(size, 0.f);
+        this->material.resize(size, 0);
+    }
+    const uint32_t index = count++;
+    positionX[index] = x; positionY[index] = y; positionZ[index] = z;
+    rotationX[index] = qx; rotationY[index] = qy; rotationZ[index] = qz; rotationW[index] = qw;
+    this->scale[index] = scale;
+    this->material[index] = material;
+    return index;
+}
+
+void TransformSystem::update(const rapid::matrix& model, const rapid::matrix& view, const rapid::matrix& viewProj,
+    Instance *instances, ThreadPool *threadPool) const
+{
+    const float *m = reinterpret_cast<const float *>(&model);
+    const float *v = reinterpret_cast<const float *>(&view);
+    const float *vp = reinterpret_cast<const float *>(&viewProj);
+    const uint32_t groupCount = getPaddedCount()/4;
+    if (threadPool && groupCount >= minParallelGroups * 2)
+    {
+        threadPool->parallelFor(groupCount, [&](uint32_t begin, uint32_t end)
+        {
+            updateGroups(begin, end, m, v, vp, instances);
+        });
+    }
+    else
+        updateGroups(0, groupCount, m, v, vp, instances);
+}
+
+void TransformSystem::updateGroups(uint32_t begin, uint32_t end, const float *model, const float *view, const float *viewProj,
+    Instance *instances) const
+{
+    __m128 m[16], v[16], vp[16];
+    broadcast(model, m);
+    broadcast(view, v);
+    broadcast(viewProj, vp);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 two = _mm_set1_ps(2.f);
+    for (uint32_t group = begin; group < end; ++group)
+    {
+        const uint32_t first = group * 4;
+        const __m128 x = _mm_loadu_ps(&rotationX[first]);
+        const __m128 y = _mm_loadu_ps(&rotationY[first]);
+        const __m128 z = _mm_loadu_ps(&rotationZ[first]);
+        const __m128 w = _mm_loadu_ps(&rotationW[first]);
+        const __m128 s = _mm_loadu_ps(&scale[first]);
+        // Rotation of unit quaternion, rows transform row vector
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+        const __m128 s2 = _mm_mul_ps(s, two);
+        __m128 local[16];
+        local[0] = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+        local[1] = _mm_mul_ps(s2, _mm_add_ps(xy, zw));
+        local[2] = _mm_mul_ps(s2, _mm_sub_ps(xz, yw));
+        local[4] = _mm_mul_ps(s2, _mm_sub_ps(xy, zw));
+        local[5] = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+        local[6] = _mm_mul_ps(s2, _mm_add_ps(yz, xw));
+        local[8] = _mm_mul_ps(s2, _mm_add_ps(xz, yw));
+        local[9] = _mm_mul_ps(s2, _mm_sub_ps(yz, xw));
+        local[10] = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+        local[3] = local[7] = local[11] = _mm_setzero_ps();
+        local[12] = _mm_loadu_ps(&positionX[first]);
+        local[13] = _mm_loadu_ps(&positionY[first]);
+        local[14] = _mm_loadu_ps(&positionZ[first]);
+        local[15] = one;
+        // Model is applied first: world = model * local
+        __m128 world[16], worldView[16], worldViewProj[16];
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int col = 0; col < 3; ++col)
+            {
+                __m128 sum = _mm_mul_ps(m[row * 4], local[col]);
+                sum = _mm_add_ps(sum, _mm_mul_ps(m[row * 4 + 1], local[4 + col]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(m[row * 4 + 2], local[8 + col]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(m[row * 4 + 3], local[12 + col]));
+                world[row * 4 + col] = sum;
+            }
+            world[row * 4 + 3] = m[row * 4 + 3]; // Last column of local is (0, 0, 0, 1)
+        }
+        multiply(world, v, worldView);
+        multiply(world, vp, worldViewProj);
+        Instance *dst = instances + first;
+        store(worldView, dst, offsetof(Instance, worldView));
+        store(worldViewProj, dst, offsetof(Instance, worldViewProj));
+        for (int i = 0; i < 4; ++i)
+        {
+            _mm_stream_si128(reinterpret_cast<__m128i *>(&dst[i].material),
+                _mm_setr_epi32(static_cast<int>(material[first + i]), 0, 0, 0));
+        }
+    }
+    _mm_sfence(); // Make streaming stores visible before submission
+}
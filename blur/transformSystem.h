@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../rapid/rapid.h"
+
+class ThreadPool;
+
+// Transforms of many objects stored as structure of arrays: position, rotation
+// quaternion and uniform scale. Matrices are rebuilt in groups of four objects,
+// one object per SSE lane, and streamed into (usually mapped) output memory.
+class TransformSystem
+{
+public:
+    // Matches Instance in transform.vert
+    struct alignas(16) Instance
+    {
+        rapid::matrix worldView;
+        rapid::matrix worldViewProj;
+        uint32_t material;
+    };
+
+    uint32_t add(float x, float y, float z, // Position
+        float qx, float qy, float qz, float qw, // Rotation
+        float scale, uint32_t material);
+    uint32_t getCount() const { return count; }
+    // Output has this many instances, tail of the last group is degenerate
+    uint32_t getPaddedCount() const { return static_cast<uint32_t>(scale.size()); }
+    // Model transform shared by all objects is applied before their own ones.
+    // Output must be 16-byte aligned. Large counts are split between threads.
+    void update(const rapid::matrix& model, const rapid::matrix& view, const rapid::matrix& viewProj,
+        Instance *instances, ThreadPool *threadPool) const;
+
+private:
+    void updateGroups(uint32_t begin, uint32_t end, const float *model, const float *view, const float *viewProj,
+        Instance *instances) const;
+
+    static constexpr uint32_t minParallelGroups = 1024; // Below that threads cost more than they save
+
+    uint32_t count = 0;
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scale;
+    std::vector<uint32_t> material;
+};
@@ -0,0 +1,123 @@
+#include <stdexcept>
+#include "transientAttachment.h"
+
+namespace
+{
+VkImageAspectFlags aspectMask(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+} // namespace
+
+TransientAttachment::TransientAttachment(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    VkFormat format, const VkExtent2D& extent, VkImageUsageFlags usage,
+    const VkAllocationCallbacks *allocator /* nullptr */):
+    device(std::move(device)),
+    allocator(allocator),
+    format(format),
+    image(VK_NULL_HANDLE),
+    memory(VK_NULL_HANDLE),
+    view(VK_NULL_HANDLE),
+    memorySize(0),
+    memoryType(0),
+    lazilyAllocated(false)
+{
+    VkImageCreateInfo imageInfo;
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.pNext = nullptr;
+    imageInfo.flags = 0;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // Only attachment usages are allowed together with transient one
+    imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.queueFamilyIndexCount = 0;
+    imageInfo.pQueueFamilyIndices = nullptr;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(*this->device, &imageInfo, allocator, &image) != VK_SUCCESS)
+        throw std::runtime_error("failed to create transient attachment");
+    try
+    {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(*this->device, image, &requirements);
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(*physicalDevice, &memoryProperties);
+        const VkMemoryPropertyFlags preferredProperties[] = {
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+        bool found = false;
+        for (VkMemoryPropertyFlags properties : preferredProperties)
+        {
+            for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && !found; ++i)
+            {
+                if ((requirements.memoryTypeBits & (1 << i)) &&
+                    (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                {
+                    memoryType = i;
+                    lazilyAllocated = (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+                    found = true;
+                }
+            }
+        }
+        if (!found)
+            throw std::runtime_error("no suitable memory type for transient attachment");
+        VkMemoryAllocateInfo allocInfo;
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+        if (vkAllocateMemory(*this->device, &allocInfo, allocator, &memory) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate transient attachment memory");
+        memorySize = requirements.size;
+        vkBindImageMemory(*this->device, image, memory, 0);
+        VkImageViewCreateInfo viewInfo;
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.pNext = nullptr;
+        viewInfo.flags = 0;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.components = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY};
+        viewInfo.subresourceRange = {aspectMask(format), 0, 1, 0, 1};
+        if (vkCreateImageView(*this->device, &viewInfo, allocator, &view) != VK_SUCCESS)
+            throw std::runtime_error("failed to create transient attachment view");
+    }
+    catch (...)
+    {
+        destroy();
+        throw;
+    }
+}
+
+TransientAttachment::~TransientAttachment()
+{
+    destroy();
+}
+
+void TransientAttachment::destroy()
+{
+    vkDestroyImageView(*device, view, allocator);
+    vkDestroyImage(*device, image, allocator);
+    vkFreeMemory(*device, memory, allocator);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "../magma/magma.h"
+
+// Attachment that lives only within render pass: cleared on load and not
+// stored, like offscreen depth. Backed by lazily allocated memory if device
+// has it, so tiler may never commit memory for it; device local otherwise.
+class TransientAttachment
+{
+public:
+    explicit TransientAttachment(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+        VkFormat format, const VkExtent2D& extent, VkImageUsageFlags usage,
+        const VkAllocationCallbacks *allocator = nullptr);
+    ~TransientAttachment();
+    TransientAttachment(const TransientAttachment&) = delete;
+    TransientAttachment& operator=(const TransientAttachment&) = delete;
+    VkImage getHandle() const { return image; }
+    VkImageView getView() const { return view; }
+    VkFormat getFormat() const { return format; }
+    // Upper bound, lazily allocated memory may be committed partially or not at all
+    VkDeviceSize getMemorySize() const { return memorySize; }
+    uint32_t getMemoryType() const { return memoryType; }
+    bool isLazilyAllocated() const { return lazilyAllocated; }
+
+private:
+    void destroy();
+
+    std::shared_ptr<magma::Device> device;
+    const VkAllocationCallbacks *allocator;
+    const VkFormat format;
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    VkDeviceSize memorySize;
+    uint32_t memoryType;
+    bool lazilyAllocated;
+};
@@ -1,6 +1,51 @@
-#include <sstream>
-#include <fstream>
+#include <cstdio>
 #include "vkApp.h"
+#include "pipelineCacheFile.h"
+#include "mappedFile.h"
+#include "embeddedShaders.h"
+#include "hash.h"
+
+namespace
+{
+// Routes host allocations of magma objects to HostAllocator
+class TrackingAllocator : public magma::IAllocator
+{
+public:
+    explicit TrackingAllocator(std::shared_ptr<HostAllocator> allocator):
+        allocator(std::move(allocator))
+    {}
+
+    void *alloc(std::size_t size, std::size_t alignment, VkSystemAllocationScope allocationScope) override
+    {
+        return allocator->allocate(size, alignment, allocationScope);
+    }
+
+    void *realloc(void *original, std::size_t size, std::size_t alignment, VkSystemAllocationScope allocationScope) override
+    {
+        return allocator->reallocate(original, size, alignment, allocationScope);
+    }
+
+    void free(void *memory) noexcept override
+    {
+        allocator->free(memory);
+    }
+
+    void internalAllocationNotification(std::size_t size, VkInternalAllocationType allocationType,
+        VkSystemAllocationScope allocationScope) noexcept override
+    {
+        allocator->internalAllocation(size, allocationScope);
+    }
+
+    void internalFreeNotification(std::size_t size, VkInternalAllocationType allocationType,
+        VkSystemAllocationScope allocationScope) noexcept override
+    {
+        allocator->internalFree(size, allocationScope);
+    }
+
+private:
+    std::shared_ptr<HostAllocator> allocator;
+};
+} // namespace
 
 #ifndef _WIN64
 void *VkApp::operator new(size_t size)
@@ -17,38 +62,182 @@ void VkApp::operator delete(void *ptr) noexcept
 }
 #endif // _WIN64
 
-VkApp::VkApp(HINSTANCE instance, HWND wnd, uint32_t width, uint32_t height):
-    width(width),
-    height(height)
+VkApp::VkApp(const AppEntry& entry):
+    width(entry.width),
+    height(entry.height),
+    headless(entry.headless),
+    colorFormat(VK_FORMAT_R8G8B8A8_UNORM),
+    frameIndex(0),
+    descriptorIndexing(false),
+    pipelineCacheFileName(entry.pipelineCacheFileName ? entry.pipelineCacheFileName : ""),
+    pipelineCacheWarm(false),
+    createTime(std::chrono::high_resolution_clock::now()),
+    startupTime(0.)
 {
     createInstance();
     createLogicalDevice();
-    createSwapchain(instance, wnd, false);
+    bufferPool = std::make_shared<DeviceMemoryPool>(device, physicalDevice, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        16 * 1024 * 1024, hostAllocator->getCallbacks());
+    stagingPool = std::make_shared<DeviceMemoryPool>(device, physicalDevice,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 4 * 1024 * 1024,
+        hostAllocator->getCallbacks());
+    if (headless)
+        createOffscreenTargets();
+    else
+        createSwapchain(entry);
     createRenderPass();
     createFramebuffer();
     createCommandBuffers();
     createSyncPrimitives();
-    pipelineCache = std::make_shared<magma::PipelineCache>(device);
+    pipelineCache = loadPipelineCache(device, physicalDevice,
+        pipelineCacheFileName.empty() ? nullptr : pipelineCacheFileName.c_str(), pipelineCacheWarm);
+    profiler = std::make_unique<Profiler>(device, physicalDevice, queue->getFamilyIndex(),
+        static_cast<uint32_t>(commandBuffers.size()));
+    threadPool = std::make_unique<ThreadPool>();
+    if (entry.assetPackageFileName)
+    {
+        try
+        {
+            assetPackage = std::make_unique<AssetPackage>(entry.assetPackageFileName);
+        }
+        catch (const std::exception& exc)
+        {
+            debugOutput((std::string(exc.what()) + ", loading loose asset files\n").c_str());
+        }
+    }
 }
 
 VkApp::~VkApp()
 {
+    if (!pipelineCacheFileName.empty())
+    {   // Pipelines created by derived class are already in the cache
+        try
+        {
+            if (!savePipelineCache(pipelineCache, physicalDevice, pipelineCacheFileName.c_str()))
+                debugOutput("Failed to save pipeline cache\n");
+        }
+        catch (...)
+        {
+            debugOutput("Failed to save pipeline cache\n");
+        }
+    }
 }
 
 void VkApp::render()
 {
-    const uint32_t bufferIndex = swapchain->acquireNextImage(presentFinished, nullptr);
+    profiler->beginFrame();
+    Profiler::ScopedSpan span(profiler.get(), "render");
+    uint32_t bufferIndex;
+    if (headless)
+        bufferIndex = frameIndex % static_cast<uint32_t>(offscreenTargets.size());
+    else
+        bufferIndex = swapchain->acquireNextImage(presentFinished, nullptr);
     waitFences[bufferIndex]->wait();
     waitFences[bufferIndex]->reset();
+    profiler->collect(bufferIndex);
+    if (frameCapture)
+        frameCapture->poll();
     {
+        Profiler::ScopedSpan span(profiler.get(), "onRender");
         onRender(bufferIndex);
     }
-    queue->present(swapchain, bufferIndex, renderFinished);
-    device->waitIdle(); // Flush
+    profiler->submitted(bufferIndex);
+    bool captured = false;
+    if (!nextCaptureFileName.empty() || !captureFileNamePrefix.empty() || frameStream)
+    {
+        Profiler::ScopedSpan span(profiler.get(), "capture");
+        captured = captureFrame(bufferIndex);
+    }
+    if (!headless)
+        queue->present(swapchain, bufferIndex, captured ? captureFinished : renderFinished);
+    if (!frameIndex)
+    {
+        const auto now = std::chrono::high_resolution_clock::now();
+        startupTime = std::chrono::duration<double, std::milli>(now - createTime).count();
+    }
+    ++frameIndex;
 }
 
 void VkApp::onKeyDown(char key, int repeat, uint32_t flags)
 {
+    switch (key)
+    {
+    case 'S': // Save screenshot
+        captureNextFrame("screenshot" + std::to_string(frameIndex) + ".png");
+        break;
+    }
+}
+
+void VkApp::captureNextFrame(const std::string& fileName)
+{
+    nextCaptureFileName = fileName;
+}
+
+void VkApp::captureAllFrames(const std::string& fileNamePrefix)
+{
+    captureFileNamePrefix = fileNamePrefix;
+}
+
+FrameCapture::Statistics VkApp::finishCaptures()
+{
+    if (!frameCapture)
+        return FrameCapture::Statistics();
+    frameCapture->flush();
+    return frameCapture->getStatistics();
+}
+
+void VkApp::recordFrames(const std::string& fileName, bool blocking)
+{
+    createFrameCapture();
+    frameStream = std::make_shared<FrameStream>(fileName, width, height, blocking);
+    frameCapture->setStream(frameStream);
+}
+
+FrameStream::Statistics VkApp::finishRecording()
+{
+    if (!frameStream)
+        return FrameStream::Statistics();
+    frameCapture->setStream(nullptr);
+    frameStream->close();
+    const FrameStream::Statistics statistics = frameStream->getStatistics();
+    frameStream.reset();
+    return statistics;
+}
+
+std::shared_ptr<magma::Image> VkApp::getFramebufferImage(uint32_t index) const
+{
+    if (headless)
+        return offscreenTargets[index];
+    return swapchain->getImages()[index];
+}
+
+void VkApp::createFrameCapture()
+{
+    if (frameCapture)
+        return;
+    const bool bgra = (VK_FORMAT_B8G8R8A8_UNORM == colorFormat) || (VK_FORMAT_B8G8R8A8_SRGB == colorFormat);
+    frameCapture = std::make_unique<FrameCapture>(device, commandPools[0], VkExtent2D{width, height}, bgra,
+        3, memoryTracker);
+    if (!headless)
+        captureFinished = std::make_shared<magma::Semaphore>(device);
+}
+
+bool VkApp::captureFrame(uint32_t bufferIndex)
+{
+    createFrameCapture();
+    std::string fileName;
+    if (!nextCaptureFileName.empty())
+        fileName.swap(nextCaptureFileName);
+    else if (!captureFileNamePrefix.empty())
+    {
+        char index[16];
+        snprintf(index, sizeof(index), "%05u", frameIndex);
+        fileName = captureFileNamePrefix + index + ".png";
+    }
+    // Copy goes after the frame in queue order, then frame is presented
+    return frameCapture->capture(queue, getFramebufferImage(bufferIndex),
+        headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        renderFinished, captureFinished, fileName, frameStream != nullptr);
 }
 
 void VkApp::createInstance()
@@ -58,19 +247,32 @@ void VkApp::createInstance()
         "VK_LAYER_LUNARG_standard_validation"
 #endif
     };
-    const std::vector<const char *> extensionNames = {
-        VK_KHR_SURFACE_EXTENSION_NAME,
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+    std::vector<const char *> extensionNames;
+    if (!headless)
+    {
+        extensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+        extensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+        extensionNames.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+#endif
+    }
 #ifdef _DEBUG
-        VK_EXT_DEBUG_REPORT_EXTENSION_NAME
+    extensionNames.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 #endif
-    };
+    instanceExtensions = std::make_unique<magma::InstanceExtensions>();
+    if (instanceExtensions->KHR_get_physical_device_properties2)
+    {   // For memory budget query
+        extensionNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
 
+    hostAllocator = std::make_shared<HostAllocator>();
     instance = std::make_shared<magma::Instance>(
         "vkApp",
         "Magma",
         VK_API_VERSION_1_0,
-        layerNames, extensionNames);
+        layerNames, extensionNames,
+        std::make_shared<TrackingAllocator>(hostAllocator));
 
     debugReportCallback = std::make_shared<magma::DebugReportCallback>(
         instance,
@@ -78,10 +280,9 @@ void VkApp::createInstance()
 
     physicalDevice = instance->getPhysicalDevice(0);
     const VkPhysicalDeviceProperties& properties = physicalDevice->getProperties();
-    OutputDebugString(properties.deviceName);
-    OutputDebugString("\n");
+    debugOutput(properties.deviceName);
+    debugOutput("\n");
 
-    instanceExtensions = std::make_unique<magma::InstanceExtensions>();
     extensions = std::make_unique<magma::PhysicalDeviceExtensions>(physicalDevice);
 }
 
@@ -98,21 +299,66 @@ void VkApp::createLogicalDevice()
     // Enable BC textures
     VkPhysicalDeviceFeatures features = {0};
     features.textureCompressionBC = VK_TRUE;
+    // Enable GPU profiling
+    features.pipelineStatisticsQuery = physicalDevice->getFeatures().pipelineStatisticsQuery;
 
     std::vector<const char*> enabledExtensions;
-    enabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!headless)
+        enabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     if (extensions->AMD_negative_viewport_height)
         enabledExtensions.push_back(VK_AMD_NEGATIVE_VIEWPORT_HEIGHT_EXTENSION_NAME);
     else if (extensions->KHR_maintenance1)
         enabledExtensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+    // Enable heap budget and usage query
+    const bool memoryBudget = extensions->EXT_memory_budget && instanceExtensions->KHR_get_physical_device_properties2;
+    if (memoryBudget)
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    // Enable non-uniform indexing of texture arrays for bindless materials
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    std::vector<void *> extendedFeatures;
+    if (extensions->EXT_descriptor_indexing && extensions->KHR_maintenance3 &&
+        instanceExtensions->KHR_get_physical_device_properties2)
+    {
+        PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(*instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        VkPhysicalDeviceFeatures2KHR features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features2.pNext = &descriptorIndexingFeatures;
+        if (getFeatures2)
+            getFeatures2(*physicalDevice, &features2);
+        descriptorIndexing = (VK_TRUE == descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing);
+        // Other features are not used
+        descriptorIndexingFeatures = {};
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        if (descriptorIndexing)
+        {
+            descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            extendedFeatures.push_back(&descriptorIndexingFeatures);
+            enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+    }
 
     const std::vector<const char*> noLayers;
-    device = physicalDevice->createDevice(queueDescriptors, noLayers, enabledExtensions, features);
+    device = physicalDevice->createDevice(queueDescriptors, noLayers, enabledExtensions, features, extendedFeatures);
+
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+    if (memoryBudget)
+    {
+        getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(*instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+    }
+    memoryTracker = std::make_shared<MemoryTracker>(physicalDevice, getMemoryProperties2);
 }
 
-void VkApp::createSwapchain(HINSTANCE hInstance, HWND wnd, bool vSync)
+void VkApp::createSwapchain(const AppEntry& entry)
 {
-    surface = std::make_shared<magma::Win32Surface>(instance, hInstance, wnd);
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+    surface = std::make_shared<magma::Win32Surface>(instance, entry.hInstance, entry.hWnd);
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+    surface = std::make_shared<magma::XcbSurface>(instance, entry.connection, entry.window);
+#endif
     if (!physicalDevice->getSurfaceSupport(surface))
         throw std::runtime_error("surface not supported");
     // Get surface caps
@@ -147,7 +393,9 @@ void VkApp::createSwapchain(HINSTANCE hInstance, HWND wnd, bool vSync)
     // Choose available present mode
     const std::vector<VkPresentModeKHR> presentModes = physicalDevice->getSurfacePresentModes(surface);
     VkPresentModeKHR presentMode;
-    if (vSync)
+    if (std::find(presentModes.begin(), presentModes.end(), entry.presentMode) != presentModes.end())
+        presentMode = entry.presentMode;
+    else if (entry.vSync)
         presentMode = VK_PRESENT_MODE_FIFO_KHR;
     else
     {   // Search for first appropriate present mode
@@ -173,46 +421,54 @@ void VkApp::createSwapchain(HINSTANCE hInstance, HWND wnd, bool vSync)
             presentMode = VK_PRESENT_MODE_FIFO_KHR;
         }
     }
+    colorFormat = surfaceFormats[0].format;
     swapchain = std::make_shared<magma::Swapchain>(device, surface,
         std::min(2U, surfaceCaps.maxImageCount),
         surfaceFormats[0], surfaceCaps.currentExtent,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Allow screenshots
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, // Allow screenshots and blits
         preTransform, compositeAlpha, presentMode, 0,
         nullptr, debugReportCallback);
 }
 
-void VkApp::createRenderPass()
+void VkApp::createOffscreenTargets()
 {
-    const std::vector<VkSurfaceFormatKHR> surfaceFormats = physicalDevice->getSurfaceFormats(surface);
-    const magma::AttachmentDescription colorAttachment(surfaceFormats[0].format, 1,
+    const VkExtent2D extent{width, height};
+    constexpr uint32_t imageCount = 2; // Same as swapchain
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        offscreenTargets.push_back(std::make_shared<magma::ColorAttachment2D>(device, colorFormat, extent, 1, 1));
+        memoryTracker->add("offscreenTarget" + std::to_string(i), MemoryTag::Attachment, offscreenTargets.back());
+    }
+}
+
+void VkApp::createRenderPass()
+{   // Swapchain pass draws only full-screen quads, so it has no depth attachment
+    const magma::AttachmentDescription colorAttachment(colorFormat, 1,
         magma::op::clearStore, // Clear color, store
         magma::op::dontCare, // Stencil don't care
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-
-    const VkFormat depthFormat = getSupportedDepthFormat(physicalDevice, false, true);
-    const magma::AttachmentDescription depthStencilAttachment(depthFormat, 1,
-        magma::op::clearStore, // Clear depth, store
-        magma::op::clearDontCare, // Stencil don't care
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-    const std::initializer_list<magma::AttachmentDescription> attachments = {colorAttachment, depthStencilAttachment};
+        headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    const std::initializer_list<magma::AttachmentDescription> attachments = {colorAttachment};
     renderPass = std::make_shared<magma::RenderPass>(device, attachments);
 }
 
 void VkApp::createFramebuffer()
 {
-    const VkSurfaceCapabilitiesKHR surfaceCaps = physicalDevice->getSurfaceCapabilities(surface);
-    const VkFormat depthFormat = getSupportedDepthFormat(physicalDevice, false, true);
-    depthStencil = std::make_shared<magma::DepthStencilAttachment2D>(device, depthFormat, surfaceCaps.currentExtent, 1, 1);
-    depthStencilView = std::make_shared<magma::ImageView>(depthStencil);
-
-    for (const auto& image : swapchain->getImages())
+    std::vector<std::shared_ptr<magma::ImageView>> colorViews;
+    if (headless)
+    {
+        for (const auto& target : offscreenTargets)
+            colorViews.push_back(std::make_shared<magma::ImageView>(target));
+    }
+    else
+    {
+        for (const auto& image : swapchain->getImages())
+            colorViews.push_back(std::make_shared<magma::ImageView>(image));
+    }
+    for (const auto& colorView : colorViews)
     {
         std::vector<std::shared_ptr<magma::ImageView>> attachments;
-        std::shared_ptr<magma::ImageView> colorView(std::make_shared<magma::ImageView>(image));
         attachments.push_back(colorView);
-        attachments.push_back(depthStencilView);
         std::shared_ptr<magma::Framebuffer> framebuffer(std::make_shared<magma::Framebuffer>(renderPass, attachments));
         framebuffers.push_back(framebuffer);
     }
@@ -235,14 +491,17 @@ void VkApp::createCommandBuffers()
     }
     catch (...)
     {
-        OutputDebugString("Transfer queue not present\n");
+        debugOutput("Transfer queue not present\n");
     }
 }
 
 void VkApp::createSyncPrimitives()
 {
-    presentFinished = std::make_shared<magma::Semaphore>(device);
-    renderFinished = std::make_shared<magma::Semaphore>(device);
+    if (!headless)
+    {   // Nobody waits for presentation in headless mode
+        presentFinished = std::make_shared<magma::Semaphore>(device);
+        renderFinished = std::make_shared<magma::Semaphore>(device);
+    }
     for (int i = 0; i < (int)commandBuffers.size(); ++i)
     {
         constexpr bool signaled = true; // Don't wait on first render of each command buffer
@@ -273,23 +532,90 @@ VkFormat VkApp::getSupportedDepthFormat(std::shared_ptr<magma::PhysicalDevice> p
     return VK_FORMAT_UNDEFINED;
 }
 
-magma::PipelineShaderStage VkApp::loadShader(const char *fileName) const
+magma::PipelineShaderStage VkApp::loadShader(const char *fileName,
+    std::shared_ptr<magma::Specialization> specialization /* nullptr */)
 {
-    std::ifstream file(fileName, std::ios::in | std::ios::binary);
-    if (!file.is_open())
-        throw std::runtime_error("file \"" + std::string(fileName) + "\" not found");
+    const LoadedShader& shader = loadShaderModule(fileName);
+    return magma::PipelineShaderStage(shader.reflection.stage, shader.module,
+        shader.reflection.entryPoint.c_str(), std::move(specialization));
+}
 
-    std::vector<char> bytecode((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    if (bytecode.size() % sizeof(magma::SpirvWord))
+const VkApp::LoadedShader& VkApp::loadShaderModule(const char *fileName)
+{
+    {
+        std::lock_guard<std::mutex> lock(shaderMutex);
+        auto it = shaderModules.find(fileName);
+        if (it != shaderModules.end())
+            return it->second;
+    }
+    // Map file without lock, other threads may load their shaders meanwhile
+    std::unique_ptr<MappedFile> file;
+    const void *bytecode;
+    size_t bytecodeSize;
+    const EmbeddedShader *embeddedShader = findEmbeddedShader(fileName);
+    const AssetEntry *packedShader = assetPackage ? assetPackage->find(fileName) : nullptr;
+    if (packedShader && packedShader->type != AssetType::Shader)
+        packedShader = nullptr;
+    const bool inMemory = embeddedShader || packedShader; // Don't touch file system
+    if (embeddedShader)
+    {
+        bytecode = embeddedShader->bytecode;
+        bytecodeSize = embeddedShader->size;
+    }
+    else if (packedShader)
+    {
+        bytecode = assetPackage->getData(*packedShader);
+        bytecodeSize = static_cast<size_t>(packedShader->size);
+    }
+    else
+    {
+        file = std::make_unique<MappedFile>(fileName);
+        bytecode = file->getData();
+        bytecodeSize = file->getSize();
+    }
+    if (!bytecodeSize || bytecodeSize % sizeof(magma::SpirvWord))
         throw std::runtime_error("size of \"" + std::string(fileName) + "\" bytecode must be a multiple of SPIR-V word");
+    const uint64_t hash = fnv1a(bytecode, bytecodeSize);
 
-    std::shared_ptr<magma::ShaderModule> module = std::make_shared<magma::ShaderModule>(device,
-        reinterpret_cast<const magma::SpirvWord *>(bytecode.data()), bytecode.size(),
-        0, 0, true, device->getAllocator());
-
-    const VkShaderStageFlagBits stage = module->getReflection()->getShaderStage();
-    const char *const entrypoint = module->getReflection()->getEntryPointName(0);
-    return magma::PipelineShaderStage(stage, std::move(module), entrypoint);
+    std::unique_lock<std::mutex> lock(shaderMutex);
+    std::shared_future<LoadedShader> loaded;
+    auto it = shaderBytecodes.find(hash);
+    if (it != shaderBytecodes.end())
+    {   // Loaded or being loaded by another thread
+        loaded = it->second;
+        lock.unlock();
+    }
+    else
+    {   // Other threads wait for this one instead of writing the same sidecar file
+        std::promise<LoadedShader> promise;
+        loaded = promise.get_future().share();
+        shaderBytecodes.emplace(hash, loaded);
+        lock.unlock();
+        try
+        {
+            LoadedShader shader;
+            const std::string reflectionFileName = std::string(fileName) + ".refl";
+            if (inMemory || !loadReflection(reflectionFileName.c_str(), hash, shader.reflection))
+            {   // Parse instructions once, next runs read compact sidecar file
+                if (!reflectSpirv(static_cast<const uint32_t *>(bytecode), bytecodeSize/sizeof(uint32_t), shader.reflection))
+                    throw std::runtime_error("\"" + std::string(fileName) + "\" is not a valid SPIR-V module");
+                if (!inMemory && !saveReflection(reflectionFileName.c_str(), hash, shader.reflection))
+                    debugOutput(("Failed to save \"" + reflectionFileName + "\"\n").c_str());
+            }
+            // Bytecode is passed straight from mapped pages, magma reflection is not needed
+            shader.module = std::make_shared<magma::ShaderModule>(device,
+                static_cast<const magma::SpirvWord *>(bytecode), bytecodeSize,
+                static_cast<std::size_t>(hash), 0, false, device->getAllocator());
+            promise.set_value(std::move(shader));
+        }
+        catch (...)
+        {   // Waiting threads get the same error
+            promise.set_exception(std::current_exception());
+        }
+    }
+    const LoadedShader& shader = loaded.get(); // Rethrows failure
+    lock.lock();
+    return shaderModules.emplace(fileName, shader).first->second;
 }
 
 VkBool32 VKAPI_PTR VkApp::reportCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType,
@@ -298,8 +624,11 @@ VkBool32 VKAPI_PTR VkApp::reportCallback(VkDebugReportFlagsEXT flags, VkDebugRep
 {
     if (strstr(pMessage, "Extension"))
         return VK_FALSE;
-    std::stringstream msg;
-    msg << "[" << pLayerPrefix << "] " << pMessage << "\n";
-    OutputDebugString(msg.str().c_str());
+    // Don't touch heap, may be called from inside of frame
+    debugOutput("[");
+    debugOutput(pLayerPrefix);
+    debugOutput("] ");
+    debugOutput(pMessage);
+    debugOutput("\n");
     return VK_FALSE;
 }
@@ -1,6 +1,19 @@
 #pragma once
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include "../magma/magma.h"
 #include "../rapid/rapid.h"
+#include "platform.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include "spirvReflection.h"
+#include "assetPackage.h"
+#include "memoryPool.h"
+#include "hostAllocator.h"
+#include "memoryTracker.h"
+#include "frameCapture.h"
 
 class VkApp
 {
@@ -11,25 +24,55 @@ public:
     void operator delete(void *ptr) noexcept;
 #endif
 
-    explicit VkApp(HINSTANCE instance, HWND wnd, uint32_t width, uint32_t height);
+    explicit VkApp(const AppEntry& entry);
     virtual ~VkApp();
     void render();
     virtual void onKeyDown(char key, int repeat, uint32_t flags);
+    Profiler *getProfiler() const { return profiler.get(); }
+    // Milliseconds from construction until the first frame has been rendered
+    double getStartupTime() const { return startupTime; }
+    bool isPipelineCacheWarm() const { return pipelineCacheWarm; }
+    const HostAllocator *getHostAllocator() const { return hostAllocator.get(); }
+    const MemoryTracker *getMemoryTracker() const { return memoryTracker.get(); }
+    // Framebuffer is read back asynchronously and written to PNG (or PPM) file
+    void captureNextFrame(const std::string& fileName);
+    // Each frame is written to <prefix><frame index>.png until called with empty prefix
+    void captureAllFrames(const std::string& fileNamePrefix);
+    // Waits for pending captures
+    FrameCapture::Statistics finishCaptures();
+    // Every frame is streamed into Y4M or raw RGBA file. If disk can't keep up,
+    // frames are dropped, or render waits when blocking.
+    void recordFrames(const std::string& fileName, bool blocking);
+    // Waits for pending frames and closes file
+    FrameStream::Statistics finishRecording();
 
 protected:
     virtual void onRender(uint32_t bufferIndex) = 0;
-    magma::PipelineShaderStage loadShader(const char *fileName) const;
+    // Thread-safe, shader modules are shared between stages with the same file or bytecode
+    magma::PipelineShaderStage loadShader(const char *fileName,
+        std::shared_ptr<magma::Specialization> specialization = nullptr);
     VkFormat getSupportedDepthFormat(std::shared_ptr<magma::PhysicalDevice> physicalDevice,
         bool hasStencil, bool optimalTiling);
+    // Swapchain image, or offscreen target in headless mode
+    std::shared_ptr<magma::Image> getFramebufferImage(uint32_t index) const;
 
 private:
     void createInstance();
     void createLogicalDevice();
-    void createSwapchain(HINSTANCE instance, HWND wnd, bool vSync);
+    void createSwapchain(const AppEntry& entry);
+    void createOffscreenTargets();
     void createRenderPass();
     void createFramebuffer();
     void createCommandBuffers();
     void createSyncPrimitives();
+    void createFrameCapture();
+    bool captureFrame(uint32_t bufferIndex);
+    struct LoadedShader
+    {
+        std::shared_ptr<magma::ShaderModule> module;
+        ShaderReflection reflection;
+    };
+    const LoadedShader& loadShaderModule(const char *fileName);
 
     static VkBool32 VKAPI_PTR reportCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType,
         uint64_t object, size_t location, int32_t messageCode, const char *pLayerPrefix, const char *pMessage, void *pUserData);
@@ -37,13 +80,19 @@ private:
 protected:
     uint32_t width;
     uint32_t height;
+    const bool headless;
+    VkFormat colorFormat;
+    uint32_t frameIndex;
+    bool descriptorIndexing; // Sampled image arrays may be indexed with non-uniform values
 
+    std::shared_ptr<HostAllocator> hostAllocator; // Host memory of Vulkan objects
     std::shared_ptr<magma::Instance> instance;
     std::shared_ptr<magma::DebugReportCallback> debugReportCallback;
     std::shared_ptr<magma::Surface> surface;
     std::shared_ptr<magma::PhysicalDevice> physicalDevice;
     std::shared_ptr<magma::Device> device;
     std::shared_ptr<magma::Swapchain> swapchain;
+    std::vector<std::shared_ptr<magma::ColorAttachment2D>> offscreenTargets; // Used instead of swapchain in headless mode
     std::unique_ptr<magma::InstanceExtensions> instanceExtensions;
     std::unique_ptr<magma::PhysicalDeviceExtensions> extensions;
 
@@ -52,8 +101,6 @@ protected:
     std::shared_ptr<magma::CommandBuffer> cmdImageCopy;
     std::shared_ptr<magma::CommandBuffer> cmdBufferCopy;
 
-    std::shared_ptr<magma::DepthStencilAttachment2D> depthStencil;
-    std::shared_ptr<magma::ImageView> depthStencilView;
     std::shared_ptr<magma::RenderPass> renderPass;
     std::vector<std::shared_ptr<magma::Framebuffer>> framebuffers;
     std::shared_ptr<magma::Queue> queue;
@@ -62,4 +109,26 @@ protected:
     std::vector<std::shared_ptr<magma::Fence>> waitFences;
 
     std::shared_ptr<magma::PipelineCache> pipelineCache;
+    // Buffers created outside of magma share memory blocks of these pools
+    std::shared_ptr<DeviceMemoryPool> bufferPool;
+    std::shared_ptr<DeviceMemoryPool> stagingPool;
+    std::shared_ptr<MemoryTracker> memoryTracker; // Device memory of resources by tag
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<ThreadPool> threadPool; // For pipeline creation and CPU work
+    std::unique_ptr<AssetPackage> assetPackage; // Or nullptr
+
+private:
+    std::unique_ptr<FrameCapture> frameCapture; // Created on first capture
+    std::shared_ptr<FrameStream> frameStream; // While recording
+    std::shared_ptr<magma::Semaphore> captureFinished; // Present waits for copy
+    std::string nextCaptureFileName;
+    std::string captureFileNamePrefix;
+    std::string pipelineCacheFileName;
+    bool pipelineCacheWarm;
+    std::chrono::high_resolution_clock::time_point createTime;
+    double startupTime;
+    std::mutex shaderMutex;
+    std::unordered_map<std::string, LoadedShader> shaderModules; // By file name
+    // By hash of SPIR-V bytecode, pending while the first thread that needs it reflects it
+    std::unordered_map<uint64_t, std::shared_future<LoadedShader>> shaderBytecodes;
 };
@@ -3,7 +3,7 @@
 #include <sstream>
 #include "vkApp.h"
 
-std::unique_ptr<VkApp> createVulkanApp(HINSTANCE, HWND, uint32_t, uint32_t);
+std::unique_ptr<VkApp> createVulkanApp(const AppEntry&);
 
 namespace
 {
@@ -40,11 +40,11 @@ void showWindow(HWND wnd, DWORD style, LONG width, LONG height)
     SetWindowPos(wnd, HWND_TOP, x, y, cx, cy, SWP_SHOWWINDOW);
 }
 
-std::unique_ptr<VkApp> createAppInstance(HINSTANCE instance, HWND wnd, uint32_t width, uint32_t height)
+std::unique_ptr<VkApp> createAppInstance(const AppEntry& entry)
 {
     try
     {
-        return createVulkanApp(instance, wnd, width, height);
+        return createVulkanApp(entry);
     }
     catch (const magma::exception::ErrorResult& exc)
     {
@@ -83,6 +83,8 @@ LRESULT WINAPI wndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     case WM_KEYDOWN:
         if (VK_ESCAPE == wParam)
             quit = true;
+        else if (vkApp)
+            vkApp->onKeyDown(static_cast<char>(wParam), LOWORD(lParam), HIWORD(lParam));
         break;
     case WM_KEYUP:
         break;
@@ -126,7 +128,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
 
     showWindow(wnd, style, width, height);
 
-    vkApp = createAppInstance(hInstance, wnd, width, height);
+    AppEntry entry;
+    entry.hInstance = hInstance;
+    entry.hWnd = wnd;
+    entry.width = width;
+    entry.height = height;
+    vkApp = createAppInstance(entry);
     if (vkApp)
     {
         while (!quit)